@@ -0,0 +1,792 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+// wcurses_bench - micro-benchmarks for the rendering pipeline.
+//
+// Exercises the internal Buffer, ColorManager and Cursor classes directly,
+// so it needs no terminal and runs the same way on every platform. Every
+// benchmark repeats its operation until a time budget is spent and reports
+// nanoseconds, emitted bytes and heap allocations per operation.
+//
+// Before the benchmarks, the differential output of the renderer is checked
+// against a full repaint of every frame: both byte streams are interpreted by
+// a VirtualTerminal and the resulting screens have to be identical. The
+// program exits with status 1 if they are not.
+//
+// Usage: wcurses_bench [milliseconds per benchmark, default 200]
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+
+#include "wcurses/buffer.h"
+#include "wcurses/color_manager.h"
+#include "wcurses/cursor.h"
+#include "wcurses/layer.h"
+#include "wcurses/pad.h"
+#include "wcurses/structures.h"
+#include "wcurses/virtual_terminal.h"
+#include "wcurses/wcurses.h"
+
+namespace {
+
+std::atomic<unsigned long long> allocation_count(0);
+
+} // namespace
+
+// Every heap allocation of the process goes through these operators.
+void* operator new(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+  if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using curs::internal::Buffer;
+using curs::internal::ColorManager;
+using curs::internal::Cursor;
+using curs::internal::VirtualTerminal;
+
+std::chrono::milliseconds time_budget(200);
+
+// Keeps the results of benchmarked operations observable.
+volatile std::size_t sink = 0;
+
+// Per-operation counters collected while a benchmark runs.
+struct Counters {
+  std::size_t bytes = 0; // Bytes of terminal output produced.
+};
+
+// Small deterministic generator, so that every run changes the same cells.
+class Random {
+  public:
+    explicit Random(unsigned seed) : state_(seed) {}
+
+    unsigned Next(unsigned limit) {
+      state_ = state_ * 1664525u + 1013904223u;
+      return (state_ >> 8) % limit;
+    }
+
+  private:
+    unsigned state_;
+};
+
+// Repeats operation until the time budget is spent and prints one result line.
+// operation performs ops_per_call operations per call and adds the output it
+// produces to the counters.
+template <typename Operation>
+void Run(const std::string& name, const curs::Size& size, long ops_per_call,
+         Operation operation) {
+  Counters counters;
+
+  // Warm up: first calls allocate buffers that are reused afterwards.
+  operation(counters);
+  counters = Counters();
+
+  unsigned long long allocations_before = allocation_count.load();
+  long calls = 0;
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start;
+
+  do {
+    for (int i = 0; i < 16; ++i) {
+      operation(counters);
+    }
+
+    calls += 16;
+    end = Clock::now();
+  } while (end - start < time_budget);
+
+  unsigned long long allocations = allocation_count.load() - allocations_before;
+  double ops = static_cast<double>(calls) * ops_per_call;
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+  std::printf("%-34s %4dx%-4d %12.1f %12.1f %10.3f\n",
+              name.c_str(), size.cols, size.rows,
+              ns / ops, counters.bytes / ops, allocations / ops);
+}
+
+// Fills the buffer with text so that refreshes have something to compare.
+void FillBuffer(Buffer& buffer, const curs::Size& size, Random& random) {
+  std::string line(size.cols, ' ');
+
+  for (short y = 0; y < size.rows; ++y) {
+    for (char& ch : line) {
+      ch = static_cast<char>('a' + random.Next(26));
+    }
+
+    buffer.Move(y, 0);
+    buffer.Write(line.data(), line.size());
+  }
+}
+
+// Sets up a few color pairs, including one that uses a custom RGB color.
+void InitColors(Buffer& buffer) {
+  buffer.StartColor();
+  buffer.InitColor(20, 30, 144, 255);
+  buffer.InitPair(1, 2, 0);
+  buffer.InitPair(2, 7, 4);
+  buffer.InitPair(3, 20, 0);
+}
+
+void BenchWriteChar(const curs::Size& size) {
+  Buffer buffer(size);
+  long cells = static_cast<long>(size.rows) * size.cols;
+
+  Run("Buffer<<char (full screen)", size, cells, [&](Counters&) {
+    buffer.Move(0, 0);
+
+    for (long i = 0; i < cells; ++i) {
+      buffer << static_cast<char>('a' + i % 26);
+    }
+  });
+}
+
+void BenchWriteString(const curs::Size& size) {
+  Buffer buffer(size);
+  std::string line(size.cols, 'x');
+
+  Run("Buffer<<string (row per op)", size, size.rows, [&](Counters&) {
+    buffer.Move(0, 0);
+
+    for (short y = 0; y < size.rows; ++y) {
+      buffer << line;
+    }
+  });
+
+  std::string text;
+  for (int i = 0; i < 40; ++i) {
+    text += "log entry with a short message\n";
+  }
+
+  buffer.SetScrolling(true);
+
+  Run("Buffer<<string (lines, scrolling)", size, 40, [&](Counters&) {
+    buffer << text;
+  });
+}
+
+// Clears a panel cell by cell and with a rectangle operation, and
+// highlights one of its rows.
+void BenchRect(const curs::Size& size) {
+  Buffer buffer(size);
+  InitColors(buffer);
+
+  const curs::Rect panel {1, 1, static_cast<short>(size.rows - 2), static_cast<short>(size.cols / 2)};
+  const long cells = static_cast<long>(panel.rows) * panel.cols;
+
+  Run("Buffer<<char (panel)", size, cells, [&](Counters&) {
+    for (short y = panel.y; y < panel.y + panel.rows; ++y) {
+      buffer.Move(y, panel.x);
+
+      for (short x = 0; x < panel.cols; ++x) {
+        buffer << ' ';
+      }
+    }
+  });
+
+  Run("Buffer::ClearRect (panel)", size, cells, [&](Counters&) {
+    buffer.ClearRect(panel);
+  });
+
+  Run("Buffer::ChangeAttrRect (row)", size, panel.cols, [&](Counters&) {
+    buffer.ChangeAttrRect({static_cast<short>(size.rows / 2), panel.x, 1, panel.cols},
+                          curs::Attr::kReverse, 2);
+  });
+}
+
+// Scrolls a viewport through a log of 100000 lines kept in a pad.
+void BenchPad(const curs::Size& size) {
+  const long lines = 100000;
+  Buffer buffer(size);
+  curs::Pad pad(lines, size.cols);
+
+  Run("Pad<<string (log line)", size, 1, [&](Counters&) {
+    pad << "log entry with a short message\n";
+  });
+
+  pad.MoveTo(0, 0);
+
+  for (long i = 0; i < lines; ++i) {
+    pad << "entry " << i << ": a short message\n";
+  }
+
+  const curs::Rect viewport {0, 0, size.rows, size.cols};
+  long top = 0;
+
+  Run("Buffer::DrawPad (scroll by one)", size, 1, [&](Counters& counters) {
+    top = (top + 1) % (lines - size.rows);
+    buffer.DrawPad(pad, curs::PointL(top, 0), viewport);
+    buffer.RefreshScreenBuffer();
+    counters.bytes += buffer.GetFrameSize();
+  });
+
+  sink = sink + pad.GetChunkCount();
+}
+
+void BenchWriteNumbers(const curs::Size& size) {
+  Buffer buffer(size);
+  buffer.SetScrolling(true);
+
+  Run("Buffer<<int", size, 1000, [&](Counters&) {
+    for (int i = 0; i < 1000; ++i) {
+      buffer << (i * 7919 - 500000) << ' ';
+    }
+  });
+
+  Run("Buffer<<double", size, 1000, [&](Counters&) {
+    for (int i = 0; i < 1000; ++i) {
+      buffer << (i * 0.37 - 100.0) << ' ';
+    }
+  });
+}
+
+// Refreshes after changing the given share of cells (in percent) per frame.
+void BenchRefresh(const curs::Size& size, int changed_percent, bool with_color) {
+  Buffer buffer(size);
+  Random random(42);
+
+  if (with_color) {
+    InitColors(buffer);
+  }
+
+  FillBuffer(buffer, size, random);
+  buffer.RefreshScreenBuffer();
+
+  long cells = static_cast<long>(size.rows) * size.cols;
+  long changes = cells * changed_percent / 100;
+
+  std::string name = "RefreshScreenBuffer " + std::to_string(changed_percent) + "%" +
+                     (with_color ? " color" : "");
+
+  Run(name, size, 1, [&](Counters& counters) {
+    for (long i = 0; i < changes; ++i) {
+      buffer.Move(static_cast<short>(random.Next(size.rows)),
+                  static_cast<short>(random.Next(size.cols)));
+
+      if (with_color) {
+        buffer.SetActivePair(static_cast<short>(random.Next(4)));
+      }
+
+      buffer << static_cast<char>('a' + random.Next(26));
+    }
+
+    buffer.RefreshScreenBuffer();
+    counters.bytes += buffer.GetFrameSize();
+  });
+}
+
+// Repaints a mostly empty screen with a border and a few labels, as a
+// whole, the way it is drawn first or after a resize.
+void BenchBorderedLayout(const curs::Size& size, bool with_capabilities) {
+  Buffer buffer(size);
+  InitColors(buffer);
+
+  curs::Capabilities capabilities;
+  capabilities.repeat = with_capabilities;
+  capabilities.erase = with_capabilities;
+  buffer.SetCapabilities(capabilities);
+
+  buffer.SetActivePair(2);
+  buffer.Clear();
+
+  std::string horizontal(size.cols, '-');
+  horizontal.front() = horizontal.back() = '+';
+
+  for (short y : {static_cast<short>(0), static_cast<short>(size.rows - 1)}) {
+    buffer.Move(y, 0);
+    buffer << horizontal;
+  }
+
+  for (short y = 1; y < size.rows - 1; ++y) {
+    buffer.Move(y, 0);
+    buffer << '|';
+    buffer.Move(y, size.cols - 1);
+    buffer << '|';
+  }
+
+  buffer.SetActivePair(1);
+
+  for (short y = 2; y < size.rows - 1; y += 4) {
+    buffer.Move(y, 2);
+    buffer << "label " << y;
+  }
+
+  std::string name = std::string("RefreshScreenBuffer box") +
+                     (with_capabilities ? "" : " no RLE");
+
+  Run(name, size, 1, [&](Counters& counters) {
+    buffer.Invalidate();
+    buffer.RefreshScreenBuffer();
+    counters.bytes += buffer.GetFrameSize();
+  });
+}
+
+// Opens and closes a dialog layer over a screen full of text. Closing it
+// shows the text below again without the text being written anew.
+void BenchLayer(const curs::Size& size) {
+  Buffer buffer(size);
+  Random random(7);
+  InitColors(buffer);
+  FillBuffer(buffer, size, random);
+
+  curs::Layer* dialog = buffer.NewLayer({static_cast<short>(size.rows / 4), static_cast<short>(size.cols / 4),
+                                         static_cast<short>(size.rows / 2), static_cast<short>(size.cols / 2)});
+  curs::Window& window = dialog->GetWindow();
+  window.Attron(2);
+  window.Clear();
+  window.MoveTo(1, 2);
+  window << "Save changes?";
+  buffer.RefreshScreenBuffer();
+
+  Run("RefreshScreenBuffer dialog", size, 2, [&](Counters& counters) {
+    dialog->Hide();
+    buffer.RefreshScreenBuffer();
+    counters.bytes += buffer.GetFrameSize();
+
+    dialog->Show();
+    buffer.RefreshScreenBuffer();
+    counters.bytes += buffer.GetFrameSize();
+  });
+
+  // A busy screen below the dialog: only the uncovered cells are merged.
+  Run("RefreshScreenBuffer under dialog", size, 1, [&](Counters& counters) {
+    for (short y = 0; y < size.rows; ++y) {
+      buffer.Move(y, static_cast<short>(random.Next(size.cols)));
+      buffer << static_cast<char>('a' + random.Next(26));
+    }
+
+    buffer.RefreshScreenBuffer();
+    counters.bytes += buffer.GetFrameSize();
+  });
+}
+
+// Takes a snapshot every frame while a few rows change, as an undo history
+// or a frame handed to another thread would; the previous snapshot is
+// released. Then restores the screen behind a transient overlay.
+void BenchSnapshot(const curs::Size& size) {
+  Buffer buffer(size);
+  Random random(11);
+  FillBuffer(buffer, size, random);
+  buffer.RefreshScreenBuffer();
+
+  curs::internal::GridSnapshot snapshot;
+
+  Run("TakeSnapshot (3 rows changed)", size, 1, [&](Counters&) {
+    snapshot = buffer.TakeSnapshot();
+
+    for (int i = 0; i < 3; ++i) {
+      buffer.Move(static_cast<short>(random.Next(size.rows)), static_cast<short>(random.Next(size.cols)));
+      buffer << static_cast<char>('a' + random.Next(26));
+    }
+  });
+
+  const curs::Rect overlay {static_cast<short>(size.rows / 4), static_cast<short>(size.cols / 4),
+                            static_cast<short>(size.rows / 2), static_cast<short>(size.cols / 2)};
+  buffer.RefreshScreenBuffer();
+
+  Run("RestoreSnapshot overlay", size, 1, [&](Counters& counters) {
+    snapshot = buffer.TakeSnapshot();
+    buffer.FillRect(overlay, U'#');
+    buffer.RestoreSnapshot(snapshot);
+    buffer.RefreshScreenBuffer();
+    counters.bytes += buffer.GetFrameSize();
+  });
+}
+
+// Repaints a screen of colored words as a whole with each color depth.
+void BenchColorDepth(const curs::Size& size) {
+  const struct {
+    curs::ColorDepth depth;
+    const char* name;
+  } depths[] = {
+    {curs::ColorDepth::kTrueColor, "truecolor"},
+    {curs::ColorDepth::k256, "256 colors"},
+    {curs::ColorDepth::k16, "16 colors"},
+    {curs::ColorDepth::kMonochrome, "monochrome"}
+  };
+
+  for (const auto& depth : depths) {
+    Buffer buffer(size);
+    Random random(5);
+
+    InitColors(buffer);
+    buffer.SetColorDepth(depth.depth);
+
+    for (short y = 0; y < size.rows; ++y) {
+      buffer.Move(y, 0);
+
+      for (short x = 0; x < size.cols; x += 8) {
+        buffer.SetActivePair(static_cast<short>(random.Next(4)));
+        buffer << "word    ";
+      }
+    }
+
+    Run(std::string("RefreshScreenBuffer ") + depth.name, size, 1,
+        [&](Counters& counters) {
+      buffer.Invalidate();
+      buffer.RefreshScreenBuffer();
+      counters.bytes += buffer.GetFrameSize();
+    });
+  }
+}
+
+void BenchColorCodes(const curs::Size& size) {
+  Buffer buffer(size);
+  ColorManager color_manager;
+
+  color_manager.StartColor();
+  color_manager.InitColor(20, 30, 144, 255);
+
+  for (short pair = 1; pair < 16; ++pair) {
+    color_manager.InitPair(pair, pair % 8, pair < 8 ? 0 : 20);
+  }
+
+  Run("ColorManager::MakeColorCode(pair)", size, 1000, [&](Counters& counters) {
+    for (int i = 0; i < 1000; ++i) {
+      counters.bytes += color_manager.MakeColorCode(static_cast<short>(i % 16)).size();
+    }
+  });
+
+  Run("ColorManager::MakeColorCode(a, b)", size, 1000, [&](Counters& counters) {
+    for (int i = 0; i < 1000; ++i) {
+      counters.bytes += color_manager.MakeColorCode(static_cast<short>(i % 16),
+                                                    static_cast<short>((i * 7) % 16)).size();
+    }
+  });
+}
+
+void BenchCursor(const curs::Size& size) {
+  Cursor cursor(size.rows, size.cols);
+  Random random(7);
+
+  Run("Cursor::Move/MoveBy", size, 1000, [&](Counters&) {
+    for (int i = 0; i < 500; ++i) {
+      cursor.Move(static_cast<short>(random.Next(size.rows)),
+                  static_cast<short>(random.Next(size.cols)));
+      cursor.MoveBy(1, -1);
+    }
+
+    sink = sink + cursor.GetX();
+  });
+}
+
+void BenchVirtualTerminal(const curs::Size& size) {
+  Buffer buffer(size);
+  Random random(11);
+
+  InitColors(buffer);
+  FillBuffer(buffer, size, random);
+  buffer.RefreshScreenBuffer();
+
+  // A colored full repaint, as the input of the interpreter.
+  std::string frame;
+
+  for (const curs::FrameSegment& segment : buffer.GetFrameSegments()) {
+    frame.append(segment.data, segment.size);
+  }
+
+  VirtualTerminal terminal(size);
+
+  Run("VirtualTerminal::Write (frame)", size, 1, [&](Counters& counters) {
+    terminal.Write(frame.data(), frame.size());
+    counters.bytes += frame.size();
+  });
+}
+
+// Returns no attributes for half of the calls, random ones otherwise.
+curs::Attr RandomAttributes(Random& random) {
+  return random.Next(2) == 0 ? curs::Attr::kNormal : static_cast<curs::Attr>(random.Next(64));
+}
+
+// Text that is not ASCII: wide characters, combining marks and flags.
+const char* const kUnicodeSamples[] = {
+  "\xe6\x97\xa5\xe6\x9c\xac",                 // Two wide characters.
+  "e\xcc\x81",                               // e with a combining acute accent.
+  "\xe2\x94\x80\xe2\x94\x80\xe2\x94\x80",     // Box drawing.
+  "\xf0\x9f\x87\xaf\xf0\x9f\x87\xb5",         // A flag.
+  "a\xef\xbc\xa1" "b",                       // A fullwidth letter between two narrow ones.
+};
+
+// Applies random changes (text, colors, attributes, scrolling) to both buffers, renders
+// one differentially and the other as a full repaint, and compares the screens
+// of the two virtual terminals after every frame. Returns false on the first
+// frame that differs.
+bool VerifyRefresh(const curs::Size& size, int frames) {
+  Buffer differential(size);
+  Buffer repaint(size);
+  VirtualTerminal differential_terminal(size);
+  VirtualTerminal repaint_terminal(size);
+  Random random(size.rows * size.cols);
+
+  for (Buffer* buffer : {&differential, &repaint}) {
+    InitColors(*buffer);
+    buffer->SetScrolling(true);
+  }
+
+  // A layer over part of the screen, moved, hidden and written to at random.
+  const curs::Rect dialog_rect {static_cast<short>(size.rows / 3), static_cast<short>(size.cols / 3),
+                                static_cast<short>(size.rows / 3), static_cast<short>(size.cols / 3)};
+  curs::Layer* dialogs[] = {differential.NewLayer(dialog_rect), repaint.NewLayer(dialog_rect)};
+  curs::internal::GridSnapshot snapshots[2];
+
+  for (int frame = 0; frame < frames; ++frame) {
+    int changes = static_cast<int>(random.Next(size.cols)) + 1;
+    int scroll = random.Next(8) == 0 ? static_cast<int>(random.Next(5)) - 2 : 0;
+    short top = static_cast<short>(random.Next(size.rows));
+    short bottom = static_cast<short>(top + random.Next(size.rows - top));
+    Random changes_random(random.Next(1u << 20));
+
+    for (Buffer* buffer : {&differential, &repaint}) {
+      Random local = changes_random;
+
+      for (int i = 0; i < changes; ++i) {
+        buffer->Move(static_cast<short>(local.Next(size.rows)),
+                     static_cast<short>(local.Next(size.cols)));
+        buffer->SetActivePair(static_cast<short>(local.Next(4)));
+        buffer->SetAttributes(RandomAttributes(local));
+
+        if (local.Next(4) == 0) {
+          *buffer << kUnicodeSamples[local.Next(5)];
+        } else {
+          *buffer << static_cast<char>('a' + local.Next(26));
+        }
+      }
+
+      // Runs of equal cells, to exercise the repeat and erase sequences.
+      for (int i = 0; i < 2; ++i) {
+        short y = static_cast<short>(local.Next(size.rows));
+        short x = static_cast<short>(local.Next(size.cols));
+        std::string run(local.Next(size.cols - x) + 1, local.Next(2) == 0 ? ' ' : '=');
+
+        buffer->Move(y, x);
+        buffer->SetActivePair(static_cast<short>(local.Next(4)));
+        buffer->SetAttributes(RandomAttributes(local));
+        *buffer << run;
+      }
+
+      // A rectangle, possibly reaching past the edges of the buffer.
+      if (local.Next(4) == 0) {
+        curs::Rect rect {static_cast<short>(local.Next(size.rows)),
+                         static_cast<short>(static_cast<int>(local.Next(size.cols)) - 2),
+                         static_cast<short>(local.Next(size.rows / 2) + 1),
+                         static_cast<short>(local.Next(size.cols) + 1)};
+
+        buffer->SetActivePair(static_cast<short>(local.Next(4)));
+        buffer->SetAttributes(RandomAttributes(local));
+
+        switch (local.Next(4)) {
+          case 0: buffer->FillRect(rect, U'#'); break;
+          case 1: buffer->FillRect(rect, 0x65e5); break;
+          case 2: buffer->ClearRect(rect); break;
+          default:
+            buffer->ChangeAttrRect(rect, RandomAttributes(local), static_cast<short>(local.Next(4)));
+            break;
+        }
+      }
+
+      curs::Layer* dialog = dialogs[buffer == &differential ? 0 : 1];
+
+      switch (local.Next(8)) {
+        case 0: dialog->Hide(); break;
+        case 1: dialog->Show(); break;
+        case 2:
+          dialog->Move(static_cast<short>(local.Next(size.rows)),
+                       static_cast<short>(local.Next(size.cols)));
+          break;
+        default: {
+          curs::Window& window = dialog->GetWindow();
+          window.MoveTo(static_cast<short>(local.Next(dialog_rect.rows)),
+                        static_cast<short>(local.Next(dialog_rect.cols)));
+          window.Attron(static_cast<short>(local.Next(4)));
+          window << kUnicodeSamples[local.Next(5)];
+          break;
+        }
+      }
+
+      // A snapshot taken now and then and put back frames later.
+      curs::internal::GridSnapshot& snapshot = snapshots[buffer == &differential ? 0 : 1];
+
+      switch (local.Next(16)) {
+        case 0: snapshot = buffer->TakeSnapshot(); break;
+        case 1: buffer->RestoreSnapshot(snapshot); break;
+        default: break;
+      }
+
+      if (scroll != 0) {
+        buffer->SetScrollRegion(top, bottom);
+        buffer->Scroll(static_cast<short>(scroll));
+        buffer->SetScrollRegion(0, size.rows - 1);
+      }
+    }
+
+    differential.RefreshScreenBuffer();
+    repaint.Invalidate();
+    repaint.RefreshScreenBuffer();
+
+    for (const curs::FrameSegment& segment : differential.GetFrameSegments()) {
+      differential_terminal.Write(segment.data, segment.size);
+    }
+
+    for (const curs::FrameSegment& segment : repaint.GetFrameSegments()) {
+      repaint_terminal.Write(segment.data, segment.size);
+    }
+
+    for (short y = 0; y < size.rows; ++y) {
+      for (short x = 0; x < size.cols; ++x) {
+        if (differential_terminal.At(y, x) != repaint_terminal.At(y, x)) {
+          std::printf("verify %dx%d: frame %d differs at row %d, column %d\n",
+                      size.cols, size.rows, frame, y, x);
+          return false;
+        }
+      }
+    }
+
+    if (differential_terminal.GetCursor().y != repaint_terminal.GetCursor().y ||
+        differential_terminal.GetCursor().x != repaint_terminal.GetCursor().x) {
+      std::printf("verify %dx%d: frame %d leaves the cursor elsewhere\n",
+                  size.cols, size.rows, frame);
+      return false;
+    }
+  }
+
+  std::printf("verify %dx%d: %d frames identical, %llu bytes instead of %llu\n",
+              size.cols, size.rows, frames,
+              differential_terminal.GetStats().bytes, repaint_terminal.GetStats().bytes);
+  return true;
+}
+
+#ifndef _WIN32
+// Draws a frame with more long color changes than a frame has segments
+// for, on the headless backend, and checks that it still takes a single
+// vectored write.
+bool VerifyFrameSyscalls(const curs::Size& size) {
+  const short kPairs = 48;
+
+  curs::wcurses.Initscr(size, curs::Backend::kHeadless);
+  curs::wcurses.SetColorDepth(curs::ColorDepth::kTrueColor);
+  curs::wcurses.StartColor();
+
+  for (short i = 0; i < kPairs; ++i) {
+    curs::wcurses.InitColor(static_cast<short>(16 + i), static_cast<short>(i * 5), 100, 200);
+    curs::wcurses.InitColor(static_cast<short>(16 + kPairs + i), 30, static_cast<short>(i * 5), 60);
+    curs::wcurses.InitPair(static_cast<short>(i + 1), static_cast<short>(16 + i),
+                           static_cast<short>(16 + kPairs + i));
+  }
+
+  for (short y = 0; y < size.rows; ++y) {
+    curs::wcurses.MoveTo(y, 0);
+
+    for (short x = 0; x < size.cols; ++x) {
+      curs::wcurses.Attron(static_cast<short>((y + x) % kPairs + 1));
+      curs::wcurses << static_cast<char>('a' + x % 26);
+    }
+  }
+
+  curs::wcurses.Refresh();
+
+  const unsigned long syscalls = curs::wcurses.GetFrameStats().last_frame_syscalls;
+  curs::wcurses.Endwin();
+
+  if (syscalls != 1) {
+    std::printf("verify %dx%d: a frame of %d color pairs takes %lu writes\n",
+                size.cols, size.rows, kPairs, syscalls);
+    return false;
+  }
+
+  std::printf("verify %dx%d: a frame of %d color pairs takes 1 write\n", size.cols, size.rows, kPairs);
+  return true;
+}
+#endif
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 1) {
+    time_budget = std::chrono::milliseconds(std::atoi(argv[1]));
+  }
+
+  const curs::Size sizes[] = {{24, 80}, {50, 200}, {120, 300}};
+
+  for (const curs::Size& size : sizes) {
+    if (!VerifyRefresh(size, 300)) {
+      return 1;
+    }
+
+#ifndef _WIN32
+    if (!VerifyFrameSyscalls(size)) {
+      return 1;
+    }
+#endif
+  }
+
+  std::printf("%-34s %9s %12s %12s %10s\n",
+              "benchmark", "size", "ns/op", "bytes/op", "allocs/op");
+
+  for (const curs::Size& size : sizes) {
+    BenchWriteChar(size);
+    BenchWriteString(size);
+    BenchRect(size);
+    BenchPad(size);
+    BenchWriteNumbers(size);
+
+    for (int changed_percent : {0, 1, 10, 100}) {
+      BenchRefresh(size, changed_percent, false);
+      BenchRefresh(size, changed_percent, true);
+    }
+
+    BenchBorderedLayout(size, true);
+    BenchBorderedLayout(size, false);
+    BenchLayer(size);
+    BenchSnapshot(size);
+
+    BenchColorDepth(size);
+    BenchColorCodes(size);
+    BenchCursor(size);
+    BenchVirtualTerminal(size);
+  }
+
+  return 0;
+}
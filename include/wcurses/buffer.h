@@ -16,20 +16,41 @@
 #ifndef WCURSES_BUFFER_H_
 #define WCURSES_BUFFER_H_
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
+#include "cell_grid.h"
 #include "color_manager.h"
+#include "compositor.h"
 #include "cursor.h"
+#include "pad.h"
 #include "point.h"
+#include "renderer.h"
 #include "structures.h"
+#include "unicode.h"
 
 namespace curs {
 namespace internal {
 
-struct ChType {
-  char symbol = ' ';
-  ColorManager::PairIndex color_pair = 0;
+// The state of text output into a rectangle of a Buffer: the rectangle in
+// buffer coordinates, the cursor inside it and the style of the characters
+// written next. The buffer has a view that covers all of it, and every
+// window has one of its own, so windows share the cells of the buffer.
+struct TextView {
+  // The cells written to: the grid of the buffer if null, otherwise the
+  // cells of a layer, which the rectangle is relative to.
+  CellGrid* grid = nullptr;
+  Rect rect {0, 0, 1, 1};
+  // Positions are relative to the rectangle. The limit is the part of the
+  // rectangle that lies inside the buffer.
+  Cursor cursor;
+  Attr attributes = Attr::kNormal;
+  ColorManager::PairIndex pair = 0;
+
+  // Bytes of a UTF-8 sequence that was only written in part.
+  char utf8_pending[kMaxUtf8Length];
+  std::size_t utf8_pending_length = 0;
 };
 
 // The Buffer class implements an internal mechanism for storing and
@@ -39,7 +60,7 @@ struct ChType {
 // and the current cursor position.
 class Buffer {
   public:
-    using ScreenBufferType = std::string;
+    using ScreenBufferType = Renderer::ScreenBufferType;
 
     // Constructs a Buffer with a specified color manager and size.
     explicit Buffer(Size size);
@@ -60,21 +81,117 @@ class Buffer {
     Buffer& operator<<(float val);
     Buffer& operator<<(double val);
     Buffer& operator<<(long double val);
+
+    // Sets the precision and the notation of floating-point output.
+    // The default is six digits after the decimal point, like std::to_string.
+    void SetPrecision(int precision) { float_precision_ = precision < 0 ? 0 : precision; }
+    void SetFloatFormat(FloatFormat format) { float_format_ = format; }
+
+    // Writes length characters starting at str. Newlines are located once and the
+    // text between them is copied into the buffer row segment by row segment.
+    // Text is UTF-8: wide characters take two cells, and combining characters
+    // join the character before them. A character may be split across writes.
+    Buffer& Write(const char* str, size_t length);
     
-    // Deletes the old buffer completely and creates a new one with the given size.
+    // Changes the size of the buffer, keeping the contents of the area shared by
+    // the old and the new size. Only the newly exposed cells are repainted, and
+    // the cursor is clamped to the new size.
     void Resize(Size new_size);
     void Resize(short new_rows, short new_cols);
 
-    // Converts the internal buffer (buffer_ or buffer_char_) into a linear string format.
+    // Converts the changes made to the internal buffer since the previous call
+    // into terminal output: the changed runs of cells, each reached with the
+    // shortest cursor movement, followed by the movement to the buffer's
+    // cursor. A visible cursor is hidden while large frames are drawn.
+    // An unchanged buffer produces no output.
     // If color support is available, it adds appropriate escape sequences.
-    void RefreshScreenBuffer();
+    // The output is available as segments (see Renderer) until the next call
+    // or the next change of the colors.
+    void RefreshScreenBuffer(bool cursor_visible = true);
+
+    // Enables or disables escape sequences for cursor positioning.
+    // Without them the output always holds the whole screen, which has to be
+    // written starting from the upper left corner.
+    void SetEscapeSequences(bool enable) { renderer_.SetEscapeSequences(enable); }
+
+    // Selects the optional sequences the screen buffer may use.
+    void SetCapabilities(const Capabilities& capabilities) { renderer_.SetCapabilities(capabilities); }
+
+    // Makes the next screen buffer repaint every cell, for a terminal whose
+    // contents are no longer known (e.g. after the terminal was resized).
+    void Invalidate() { renderer_.Invalidate(); }
+
+    // Forgets the changes made since the previous call, for changes that were
+    // taken from ComposeFrame directly instead of through RefreshScreenBuffer.
+    void ClearDamage();
+
+    // Creates a layer above the buffer (see Layer), or deletes one.
+    Layer* NewLayer(const Rect& rect) { return compositor_.NewLayer(this, rect); }
+    void DeleteLayer(Layer* layer) { compositor_.DeleteLayer(layer); }
+
+    // Returns the grid of the next frame: the grid of the buffer with the
+    // visible layers merged in. Its damage covers the changes made since
+    // the previous frame.
+    const CellGrid& ComposeFrame() { return compositor_.Compose(grid_); }
+
+    // Takes a snapshot of the cells of the buffer, or restores one (see
+    // GridSnapshot). Layers are not part of snapshots, and the cursor does
+    // not move.
+    GridSnapshot TakeSnapshot() { return grid_.TakeSnapshot(); }
+    void RestoreSnapshot(const GridSnapshot& snapshot) { grid_.Restore(snapshot); }
 
     // Clears the internal buffer but does not modify the screen buffer.
     void Clear();
 
-    // Moves the cursor to a new line.
+    // The rectangle operations below are clipped to the buffer once and
+    // fill whole row spans; they do not move the cursor.
+
+    // Fills rect with symbol in the current attributes and color pair. A wide
+    // symbol fills pairs of cells, and a column left over is blanked.
+    void FillRect(const Rect& rect, char32_t symbol);
+
+    // Blanks rect with the default color pair and no attributes.
+    void ClearRect(const Rect& rect);
+
+    // Sets the attributes and the color pair of the cells in rect, keeping
+    // their characters. An undefined pair is replaced with the default one.
+    void ChangeAttrRect(const Rect& rect, Attr attributes, ColorManager::PairIndex pair_index);
+
+    // Copies the part of pad whose upper left corner is origin into rect.
+    // Only the cells that differ from the ones on the screen are changed.
+    void DrawPad(const Pad& pad, const PointL& origin, const Rect& rect) { DrawPad(view_, pad, origin, rect); }
+
+    // Draws a line of length cells from (y, x) to the right or downwards.
+    void HLine(short y, short x, short length, char32_t symbol) { FillRect({y, x, 1, length}, symbol); }
+    void VLine(short y, short x, short length, char32_t symbol) { FillRect({y, x, length, 1}, symbol); }
+
+    // Output into another view of the buffer, such as a window. Positions
+    // and rectangles are relative to the view, and nothing is written
+    // outside of it. Only the view of the buffer itself scrolls.
+    void Write(TextView& view, const char* str, size_t length);
+    void Put(TextView& view, char ch);
+    void FillRect(TextView& view, const Rect& rect, char32_t symbol);
+    void ClearRect(TextView& view, const Rect& rect);
+    void ChangeAttrRect(TextView& view, const Rect& rect, Attr attributes,
+                        ColorManager::PairIndex pair_index);
+    void DrawPad(TextView& view, const Pad& pad, const PointL& origin, const Rect& rect);
+
+    // Moves the cursor to a new line. On the bottom line of the scrolling
+    // region the region scrolls up instead, if scrolling is enabled.
     void NewLine();
 
+    // Enables or disables scrolling (disabled by default). Without it,
+    // output past the bottom line stays on the bottom line.
+    void SetScrolling(bool enable) { is_scrolling_enabled_ = enable; }
+
+    // Limits scrolling to the rows [top, bottom]; by default the whole
+    // buffer scrolls. Returns false if the rows are out of range.
+    bool SetScrollRegion(short top, short bottom);
+
+    // Scrolls the scrolling region up by count lines, or down if count is
+    // negative. Does nothing unless scrolling is enabled.
+    void Scroll(short count);
+
     // Moves the cursor to the specified position.
     void Move(short y, short x);
     void Move(const Point& cursor_position);
@@ -86,6 +203,9 @@ class Buffer {
     // Initializes color support.
     void StartColor();
 
+    // Selects the colors the output may use.
+    void SetColorDepth(ColorDepth color_depth) { color_manager_.SetColorDepth(color_depth); }
+
     // Defines a custom color.
     void InitColor(ColorManager::ColorIndex color_index, const RGB& rgb);
     void InitColor(ColorManager::ColorIndex color_index, short r, short g, short b);
@@ -103,35 +223,78 @@ class Buffer {
     // Resets the active color pair to default (0).
     void ResetToDefaultPair();
 
+    // Turns text attributes on or off for the characters written next.
+    void AttributesOn(Attr attributes) { view_.attributes = view_.attributes | attributes; }
+    void AttributesOff(Attr attributes) { view_.attributes = view_.attributes & ~attributes; }
+    void SetAttributes(Attr attributes) { view_.attributes = attributes; }
+
     // Getter methods
     std::string GetCodeResetColor() { return color_manager_.GetResetCode(); }
-    const Point& GetCursorPosition() const { return cursor_.GetPosition(); } 
+    const Point& GetCursorPosition() const { return view_.cursor.GetPosition(); } 
+    Attr GetAttributes() const { return view_.attributes; }
+    int GetPrecision() const { return float_precision_; }
+    FloatFormat GetFloatFormat() const { return float_format_; }
     const Size& GetSize() const { return size_; } 
-    const std::string& GetScreenBuffer() const { return screen_buffer_; }
+    const std::vector<FrameSegment>& GetFrameSegments() const { return renderer_.GetFrameSegments(); }
+    std::size_t GetFrameSize() const { return renderer_.GetFrameSize(); }
+    const CellGrid& GetGrid() const { return grid_; }
+    const ColorManager& GetColorManager() const { return color_manager_; }
 
   private:
-    using BufferType = std::vector<std::vector<ChType>>;
-    using BufferCharType = std::vector<std::vector<char>>;
-
     const int kMinSize = 1;
 
-    ScreenBufferType screen_buffer_;
-    BufferType buffer_; // Stores characters with color information.
-    BufferCharType buffer_char_; // Stores characters without color formatting.
-    Cursor cursor_; // Tracks the current cursor position within the buffer.
+    CellGrid grid_; // Stores characters with color information.
+    Compositor compositor_; // Stacks the layers over grid_.
+    Renderer renderer_; // Converts changes in the composed frame into terminal output.
+    TextView view_; // The whole buffer, with the cursor and the style of its text.
     Size size_;
     ColorManager color_manager_; // Manages color attributes for text rendering.
 
+    bool is_scrolling_enabled_ = false;
+    short scroll_top_ = 0;    // First row of the scrolling region.
+    short scroll_bottom_ = 0; // Last row of the scrolling region.
+
+    int float_precision_ = 6;
+    FloatFormat float_format_ = FloatFormat::kFixed;
+
     // Initializes the entire Buffer object.
     void Initialize(Size size);
-   
-    // Initializes the specified buffer to the given size.
-    void InitializeBuffer(BufferType& buffer, Size size);
-    void InitializeBuffer(BufferCharType& buffer, Size size, char fill_char = ' ');
 
-    // Move all data from source to destination and clear source.
-    void MigrateBuffer(BufferCharType& source, BufferType& destination);
+    // Limits the cursor of a view to the part of its rectangle inside the
+    // buffer, which may have shrunk. Returns false if no part is left.
+    bool FitView(TextView& view) const;
+
+    // Moves the cursor of a view to a new line, see NewLine.
+    void NewLine(TextView& view);
+
+    // Writes the character of the pending UTF-8 bytes once it is complete.
+    void PutPendingUtf8(TextView& view);
+
+    // Writes a character that is not ASCII at the cursor.
+    void PutCodePoint(TextView& view, char32_t code_point);
+
+    // Finds the cell of the character before the cursor, which a combining
+    // character joins, in buffer coordinates. Returns false at the upper
+    // left corner of the view.
+    bool FindPreviousCell(const TextView& view, short* y, short* x) const;
+
+    // Converts rect from view to buffer coordinates and clips it to the
+    // view. Returns false if nothing is left.
+    bool ClipRect(TextView& view, Rect* rect) const;
+
+    // Returns the cells a view writes to.
+    CellGrid& Target(const TextView& view) { return view.grid != nullptr ? *view.grid : grid_; }
+    const CellGrid& Target(const TextView& view) const { return view.grid != nullptr ? *view.grid : grid_; }
+
+    // Replaces a wide character that loses one half by writing the columns
+    // [begin, end) of row y of grid with a blank.
+    void BreakWideCharacters(CellGrid& grid, short y, short begin, short end);
 
+    // Formats a number on the stack and writes it without temporary strings.
+    template <typename T>
+    Buffer& WriteInteger(T val);
+    template <typename T>
+    Buffer& WriteFloat(T val);
 };
 
 } // namespace internal
@@ -0,0 +1,325 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WCURSES_CELL_GRID_H_
+#define WCURSES_CELL_GRID_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "color_manager.h"
+#include "structures.h"
+#include "unicode.h"
+
+namespace curs {
+namespace internal {
+
+// A single screen cell: the character, its text attributes and the color
+// pair it is drawn with, packed into eight bytes.
+// The symbol is a code point, kWideContinuation for the right half of a wide
+// character, or a character of several code points from the GraphemeTable
+// of the grid. Cells without color support simply keep the default pair.
+struct ChType {
+  char32_t symbol = U' ';
+  Attr attributes = Attr::kNormal;
+  ColorManager::PairIndex color_pair = 0;
+};
+
+inline bool operator==(const ChType& lhs, const ChType& rhs) {
+  return lhs.symbol == rhs.symbol && lhs.attributes == rhs.attributes &&
+         lhs.color_pair == rhs.color_pair;
+}
+
+inline bool operator!=(const ChType& lhs, const ChType& rhs) {
+  return !(lhs == rhs);
+}
+
+// The range of columns [begin, end) of a row that changed since the damage
+// was last cleared. A span with begin >= end is clean.
+struct DirtySpan {
+  short begin;
+  short end;
+
+  bool IsClean() const { return begin >= end; }
+};
+
+// A scroll of the rows [top, bottom] by count lines: up for a positive
+// count, down for a negative one.
+struct ScrollOp {
+  short top;
+  short bottom;
+  short count;
+};
+
+class CellGrid;
+
+// The GridSnapshot class holds the cells of a CellGrid as they were when
+// CellGrid::TakeSnapshot was called. Taking a snapshot copies no cells: the
+// snapshot shares the rows of the grid, and a row is copied into the
+// snapshot only when the grid is about to change it for the first time. A
+// snapshot of a screen where few rows change therefore costs a few row
+// copies per frame, whatever the size of the screen.
+//
+// Snapshots are handles; copies refer to the same cells. The grid keeps no
+// snapshot alive. A grid that is resized or destroyed first copies the rows
+// its snapshots still share, so a snapshot stays valid on its own.
+//
+// Snapshots are taken and restored by the thread that writes the grid.
+// CopyRow and GetRowText may be called from any thread, e.g. by a thread
+// that draws a consistent frame while the grid is being changed.
+class GridSnapshot {
+  public:
+    // Creates an empty snapshot.
+    GridSnapshot() = default;
+
+    // Returns false for a snapshot that was not taken from a grid.
+    bool IsValid() const { return data_ != nullptr; }
+
+    // Returns the size of the grid when the snapshot was taken.
+    Size GetSize() const { return data_ != nullptr ? data_->size : Size{0, 0}; }
+
+    // Copies the cells of row y to out, which has room for GetSize().cols
+    // cells. Characters of several code points are opaque symbols of the
+    // GraphemeTable of the grid, which only the thread that writes the grid
+    // may read; GetRowText resolves them on any thread.
+    void CopyRow(short y, ChType* out) const;
+
+    // Returns the UTF-8 text of row y; the right halves of wide characters
+    // are left out.
+    std::string GetRowText(short y) const;
+
+  private:
+    friend class CellGrid;
+
+    // The grid and its snapshots, guarded by a mutex against CopyRow.
+    struct Registry;
+
+    struct Data {
+      std::shared_ptr<Registry> registry;
+      unsigned generation; // Counter of the grid when the snapshot was taken.
+      Size size;
+      std::vector<short> slots; // Storage slot of every row of the grid.
+
+      // The copies of the slots the grid changed since, by slot. A slot
+      // without a copy is still shared with the grid.
+      std::vector<std::shared_ptr<const ChType>> copies;
+
+      ~Data();
+    };
+
+    struct Registry {
+      std::mutex mutex;
+      CellGrid* grid = nullptr;
+      std::vector<Data*> snapshots; // Oldest first.
+
+      // A copy of the GraphemeTable of the grid, brought up to date when a
+      // snapshot is taken, for readers on other threads.
+      GraphemeTable graphemes;
+    };
+
+    std::shared_ptr<Data> data_;
+
+    // Returns the cells of row y: the copy of its slot, or the cells of the
+    // grid. Called with the mutex of the registry locked.
+    const ChType* FindRow(short y) const;
+};
+
+// The CellGrid class stores the cells of a screen in one row-major array.
+// The array starts on a cache line boundary and rows are addressed by a
+// fixed stride (a whole number of cache lines), so walking the grid touches
+// linear memory only, without a separate heap block per row.
+//
+// Rows are reached through a table of row slots used as a ring, so scrolling
+// the whole grid only moves the start of the ring, and scrolling a region only
+// rotates the slot numbers of its rows; no cells are copied in either case.
+//
+// The grid also records damage: for every row, the span of columns written
+// since the last ClearDamage(), and the scrolls performed since then.
+// Writers are responsible for calling MarkDirty() for the cells they change.
+//
+// Characters of several code points are kept in a GraphemeTable that
+// belongs to the grid and is copied along with the changes.
+class CellGrid {
+  public:
+    CellGrid() = default;
+    explicit CellGrid(Size size);
+    ~CellGrid();
+
+    CellGrid(const CellGrid&) = delete;
+    CellGrid& operator=(const CellGrid&) = delete;
+
+    // Changes the size of the grid. The cells in the area shared by the old
+    // and the new size are kept; the newly exposed cells are set to fill and
+    // marked as damaged. Memory is only allocated when the new size exceeds
+    // the capacity, which then grows by half to absorb repeated resizes.
+    void Resize(Size size, const ChType& fill = ChType());
+
+    // Fills every cell of the grid with the given value.
+    // Does not record damage.
+    void Fill(const ChType& cell);
+
+    // Sets the cells [begin, end) of row y to cell and marks them as damaged.
+    // The span is filled with a single std::fill_n over plain data, which the
+    // compiler turns into wide stores.
+    void FillSpan(short y, short begin, short end, const ChType& cell) {
+      std::fill_n(Row(y) + begin, end - begin, cell);
+      MarkDirty(y, begin, end);
+    }
+
+    // Extends the damage of row y to cover the columns [begin, end).
+    void MarkDirty(short y, short begin, short end) {
+      DirtySpan& span = damage_[Slot(y)];
+
+      if (begin < span.begin) {
+        span.begin = begin;
+      }
+
+      if (end > span.end) {
+        span.end = end;
+      }
+
+      is_dirty_ = true;
+    }
+
+    // Marks every cell of the grid as damaged. Recorded scrolls are dropped,
+    // as every row has to be repainted anyway.
+    void MarkAllDirty();
+
+    // Marks every row as clean and forgets the recorded scrolls.
+    void ClearDamage();
+
+    // Returns the damaged span of row y.
+    const DirtySpan& GetDirtySpan(short y) const { return damage_[Slot(y)]; }
+
+    // Scrolls the rows [top, bottom] up by count lines (down if count is
+    // negative). The rows that scroll in are set to fill and marked as damaged;
+    // the rows that only moved are not, the scroll itself is recorded instead.
+    void Scroll(short top, short bottom, short count, const ChType& fill = ChType());
+
+    // Returns the scrolls performed since the damage was last cleared, in order.
+    const std::vector<ScrollOp>& GetScrolls() const { return scrolls_; }
+
+    // Brings this grid up to date with source, which must have had the same
+    // contents when its damage was last cleared: the scrolls of source are
+    // repeated and its damaged spans copied. The damage and the scrolls are
+    // recorded here as well, in addition to the ones not cleared yet.
+    // A grid of another size receives a copy of every cell instead. The
+    // characters interned by source since the last call are copied too.
+    void CopyChanges(const CellGrid& source);
+
+    // Returns a snapshot of the cells, see GridSnapshot.
+    GridSnapshot TakeSnapshot();
+
+    // Sets the cells to the ones of snapshot, in the area shared by the two
+    // sizes, and marks the cells that differ as damaged. Rows the grid did
+    // not change since the snapshot are skipped without being compared.
+    void Restore(const GridSnapshot& snapshot);
+
+    // Returns true if any cell was marked as damaged.
+    bool IsDirty() const { return is_dirty_; }
+
+    // Returns a pointer to the first cell of row y. Writers go through the
+    // non-const overload, which first copies a row that a snapshot shares.
+    ChType* Row(short y) {
+      const short slot = Slot(y);
+
+      if (slot_generations_[slot] != generation_) {
+        PreserveSlot(slot);
+      }
+
+      return cells_ + slot * stride_;
+    }
+    const ChType* Row(short y) const { return cells_ + Slot(y) * stride_; }
+
+    // Returns the cell at the given position.
+    ChType& At(short y, short x) { return Row(y)[x]; }
+    const ChType& At(short y, short x) const { return Row(y)[x]; }
+
+    // Returns the table of the characters of several code points used by the cells.
+    GraphemeTable& GetGraphemes() { return graphemes_; }
+    const GraphemeTable& GetGraphemes() const { return graphemes_; }
+
+    // Getter methods
+    const Size& GetSize() const { return size_; }
+    short GetRows() const { return size_.rows; }
+    short GetCols() const { return size_.cols; }
+    std::size_t GetStride() const { return stride_; }
+    short GetRowCapacity() const { return row_capacity_; }
+
+  private:
+    friend class GridSnapshot;
+
+    static constexpr std::size_t kCacheLineSize = 64;
+    static constexpr std::size_t kCellsPerLine = kCacheLineSize / sizeof(ChType);
+
+    std::unique_ptr<unsigned char[]> storage_; // Raw memory, over-allocated for alignment.
+    ChType* cells_ = nullptr; // First cell of the aligned array.
+    std::size_t stride_ = 0;  // Distance between the starts of two rows, in cells.
+    short row_capacity_ = 0;  // Number of rows the storage has room for.
+    Size size_ {0, 0};
+
+    std::vector<short> row_slots_; // Storage slot of every row, used as a ring.
+    short first_row_ = 0;          // Position of row 0 in the ring.
+
+    std::vector<DirtySpan> damage_; // Damaged span of every slot.
+    std::vector<ScrollOp> scrolls_; // Scrolls since the damage was last cleared.
+    bool is_dirty_ = false;
+
+    std::vector<short> slot_scratch_; // Reused by Scroll for region rotations.
+
+    GraphemeTable graphemes_;
+
+    // Snapshots: a counter of the snapshots taken, and for every slot the
+    // value of the counter when its cells were last copied for them. Slots
+    // whose value is behind the counter are shared with a snapshot.
+    unsigned generation_ = 0;
+    std::vector<unsigned> slot_generations_;
+    std::shared_ptr<GridSnapshot::Registry> snapshots_;
+
+    static constexpr DirtySpan kCleanSpan {std::numeric_limits<short>::max(), 0};
+
+    // Returns the position of row y in the ring of slots.
+    int RingIndex(short y) const {
+      int ring_index = first_row_ + y;
+      return ring_index >= size_.rows ? ring_index - size_.rows : ring_index;
+    }
+
+    // Returns the storage slot of row y.
+    short Slot(short y) const { return row_slots_[RingIndex(y)]; }
+
+    // Copies the cells of slot into the snapshots that share it.
+    void PreserveSlot(short slot);
+
+    // Copies every shared slot into the snapshots and lets them go, before
+    // the storage is changed as a whole.
+    void DetachSnapshots();
+
+    // Rotates the slot table so that row 0 is at the start of the ring again.
+    void Linearize();
+
+    // Moves the cells into new storage with the given stride and row capacity,
+    // keeping the first rows and cols of every row.
+    void Reallocate(std::size_t stride, short row_capacity, short rows, short cols);
+};
+
+} // namespace internal
+} // namespace curs
+
+#endif // WCURSES_CELL_GRID_H_
@@ -16,9 +16,9 @@
 #ifndef WCURSES_COLOR_MANAGER_H_
 #define WCURSES_COLOR_MANAGER_H_
 
-#include <unordered_map>
+#include <array>
+#include <bitset>
 #include <string>
-#include <sstream>
 
 #include "structures.h"
 
@@ -32,20 +32,30 @@ enum class ColorType {
 
 // The ColorManager class is responsible for color management: storing color pairs and custom colors,
 // as well as converting them into escape sequences for changing colors in the terminal.
+//
+// Pairs and custom colors are kept in fixed-size arrays indexed directly by their
+// number. The escape sequences of every defined pair are built when the pair or
+// one of its colors is defined, so producing them during rendering is a lookup.
+// Colors the color depth lacks are replaced with the nearest palette entry at
+// that time as well, through tables computed once.
 class ColorManager {
   public:
     // Types for color indices and color pairs 
     using PairIndex = short;
     using ColorIndex = short;
 
-    // Maps for storing color pairs and custom colors.
-    using ColorMap = std::unordered_map<PairIndex, ColorPair>;
-    using CustomColorMap = std::unordered_map<ColorIndex, RGB>;
+    // The number of color pairs and custom colors that can be defined.
+    static constexpr int kMaxPairs = 256;
+    static constexpr int kMaxColors = 256;
 
     ColorManager();
 
     // Initializes the color system
     void StartColor();
+
+    // Selects the colors the escape sequences may use and rebuilds the
+    // sequences of every defined pair (true color by default).
+    void SetColorDepth(ColorDepth color_depth);
     
     // Initializes a custom color by adding a new value to custom_color_.
     // color_index must be in the range [0, 255].
@@ -69,36 +79,88 @@ class ColorManager {
     std::string GetResetCode() { return "\033[0m"; }
 
     // Returns the escape code to change the color for the given pair index.
-    // It uses the 256 color palette or custom colors if available
-    std::string MakeColorCode (PairIndex pair_index) const;
+    // It uses the 256 color palette or custom colors, as far as the color depth allows.
+    const std::string& MakeColorCode (PairIndex pair_index) const;
 
     // Returns the escape code for two color pairs:
     // if the pairs are the same, it returns an empty string;
     // if the pairs are different, it returns the escape sequence for what differs.
-    std::string MakeColorCode (PairIndex prev_pair_index, PairIndex new_pair_index) const;
+    const std::string& MakeColorCode (PairIndex prev_pair_index, PairIndex new_pair_index) const;
 
     // Getter methods
     bool IsStartedColor() const {return start_color_; }
+    ColorDepth GetColorDepth() const { return color_depth_; }
+
+    // Returns true if rendering has to produce color escape sequences.
+    bool HasColorOutput() const { return start_color_ && color_depth_ != ColorDepth::kMonochrome; }
     PairIndex GetActivePair() const { return current_pair_; }
     static PairIndex GetDefaultPair() { return kDefaultPair; }
 
+    // Returns true if cells may use the pair: colors are started and the pair is defined.
+    bool IsPairUsable(PairIndex pair_index) const { return start_color_ && IsPairDefined(pair_index); }
+
+    // Returns a counter that changes whenever the output of MakeColorCode
+    // may change (colors started, a pair or a color redefined).
+    unsigned GetGeneration() const { return generation_; }
+
   private:
-    ColorMap color_pairs_map_;
-    CustomColorMap custom_colors_map_;
+    // Escape sequences of one pair, built by UpdatePairCodes.
+    struct PairCodes {
+      std::string both;       // Sets the text and the background color.
+      std::string foreground; // Sets only the text color.
+      std::string background; // Sets only the background color.
+    };
+
+    std::array<ColorPair, kMaxPairs> color_pairs_;
+    std::array<PairCodes, kMaxPairs> pair_codes_;
+    std::bitset<kMaxPairs> defined_pairs_;
+
+    // The palette entries closest to a custom color, for the lower color depths.
+    struct NearestColors {
+      unsigned char palette256;
+      unsigned char palette16;
+    };
+
+    std::array<RGB, kMaxColors> custom_colors_;
+    std::array<NearestColors, kMaxColors> nearest_colors_;
+    std::bitset<kMaxColors> defined_colors_;
+
     PairIndex current_pair_;
+    ColorDepth color_depth_;
     bool start_color_;
+    unsigned generation_;
 
     static constexpr PairIndex kDefaultPair = 0;
 
-    // Adds a sequence to the ANSI string for a 256-color palette.
+    // Returns true if the pair index is in range and the pair is defined.
+    bool IsPairDefined(PairIndex pair_index) const {
+      return pair_index >= 0 && pair_index < kMaxPairs && defined_pairs_[pair_index];
+    }
+
+    // Rebuilds the escape sequences of a defined pair.
+    void UpdatePairCodes(PairIndex pair_index);
+
+    // Appends the parameters of a text or background color to an SGR sequence:
+    // a custom RGB color if one is defined for the index, a 256-color palette entry otherwise,
+    // or the nearest color the color depth allows.
+    void AppendColorParameters(std::string& color_code, ColorType color_type,
+                               short color_index) const;
+
+    // Adds the parameters of one of the 16 basic colors to an SGR sequence.
+    void MakeEscapeSequence16Color(
+        std::string& color_code,
+        ColorType color_type,
+        short color_index) const;
+
+    // Adds the parameters of a 256-color palette entry to an SGR sequence.
     void MakeEscapeSequence256Color(
-        std::ostringstream& color_code,
+        std::string& color_code,
         ColorType color_type, 
         short color_index) const;
 
-    // Adds a sequence for an RGB color to an ANSI string.
+    // Adds the parameters of an RGB color to an SGR sequence.
     void MakeEscapeSequenceRGB(
-        std::ostringstream& color_code,
+        std::string& color_code,
         ColorType color_type,
         const RGB& rbg) const;
 };
@@ -0,0 +1,121 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WCURSES_COMPOSITOR_H_
+#define WCURSES_COMPOSITOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "cell_grid.h"
+#include "structures.h"
+
+namespace curs {
+
+class Layer;
+
+namespace internal {
+
+class Buffer;
+
+// The Compositor class stacks layers, each with cells of its own, over the
+// grid of a Buffer and merges them into the grid that is rendered.
+//
+// The composed grid is kept between frames and only the damaged cells are
+// merged again: the cells written in the buffer or in a visible layer, and
+// the regions exposed by layers that were shown, hidden, moved, restacked
+// or deleted. Every damaged row span is resolved from the topmost layer
+// down; the parts a layer covers are taken from it and dropped for the
+// layers below, so cells hidden under a layer are never copied.
+//
+// Until the first layer is created the compositor is inactive and the grid
+// of the buffer is rendered directly, at no cost.
+class Compositor {
+  public:
+    Compositor();
+    ~Compositor();
+
+    // Creates a visible layer of the size of rect at its position, above
+    // all other layers. The layer belongs to the compositor.
+    Layer* NewLayer(Buffer* buffer, const Rect& rect);
+
+    // Deletes a layer created by NewLayer and exposes the region it covered.
+    void DeleteLayer(Layer* layer);
+
+    // Moves a layer above or below all other layers.
+    void Raise(Layer* layer);
+    void Lower(Layer* layer);
+
+    // Makes the region rect of the screen be merged again with the next frame.
+    void Expose(const Rect& rect) { exposed_.push_back(rect); }
+
+    // Returns true once a layer has been created.
+    bool IsActive() const { return is_active_; }
+
+    // Returns the grid to render for base, the grid of the buffer: base
+    // itself while inactive, otherwise the composed grid brought up to date.
+    // Its damage covers the cells that changed since ClearDamage.
+    const CellGrid& Compose(CellGrid& base);
+
+    // Forgets the damage of the composed grid and of the layers.
+    void ClearDamage();
+
+  private:
+    // A part [begin, end) of a row span that no layer above covers yet.
+    struct Interval {
+      short begin;
+      short end;
+    };
+
+    std::vector<std::unique_ptr<Layer>> layers_; // Bottom to top.
+    CellGrid composed_;
+    std::vector<Rect> exposed_; // Regions to merge again, in screen coordinates.
+    bool is_active_ = false;
+    bool is_full_compose_ = true; // The composed grid has to be merged completely.
+
+    std::vector<DirtySpan> row_spans_;  // Spans to merge in the current frame.
+    std::vector<Interval> uncovered_;   // Reused while a row span is resolved.
+    std::vector<Interval> next_uncovered_;
+
+    // Finds the position of layer in the stack.
+    std::vector<std::unique_ptr<Layer>>::iterator Find(Layer* layer);
+
+    // Extends the span of row y to [begin, end), clipped to the screen.
+    void AddSpan(short y, int begin, int end);
+    void AddRect(const Rect& rect);
+
+    // Repeats the scrolls of base in the composed grid where no layer is in
+    // the way, and merges the scrolled rows again everywhere else.
+    void ForwardScrolls(const CellGrid& base);
+
+    // Merges the columns [begin, end) of row y.
+    void ComposeSpan(const CellGrid& base, short y, short begin, short end);
+
+    // Copies the columns [begin, end) of row y from the cells of source,
+    // whose column 0 is at column origin_x of the screen and whose row
+    // source_y is row y. A wide character cut in half by the edge of the
+    // segment, because another source owns the other half, becomes a blank.
+    void CopySegment(const CellGrid& base, const CellGrid& source, short source_y, short origin_x,
+                     short y, short begin, short end);
+
+    // Returns the cells shown at (y, x): those of the topmost visible layer
+    // that covers the position, or base.
+    const CellGrid& GetOwner(const CellGrid& base, short y, short x) const;
+};
+
+} // namespace internal
+} // namespace curs
+
+#endif // WCURSES_COMPOSITOR_H_
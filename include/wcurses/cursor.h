@@ -95,10 +95,10 @@ class Cursor {
 
   private:
     // The minimum allowed cursor position.
-    const short kMinCursor = 0; 
+    static constexpr short kMinCursor = 0;
 
     // The minimum allowed limit size.
-    const short kMinLimit = 1; 
+    static constexpr short kMinLimit = 1;
 
     Point cursor_; // Current position of the cursor.
     Point limit_;  // Maximum allowed coordinates for the cursor.
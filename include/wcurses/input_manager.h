@@ -16,7 +16,10 @@
 #ifndef INPUT_MANAGER_H_
 #define INPUT_MANAGER_H_
 
+#include <cstddef>
+#include <string>
 #include <unordered_map>
+
 #include "key.h"
 
 namespace curs {
@@ -45,15 +48,38 @@ class InputManager {
   private:
     using KeyMap = std::unordered_map<short, curs::Key>;
 
+    static const KeyMap key_map_;
+
+#ifdef _WIN32
     // Map for converting key codes to corresponding ncurses values.
     // Each element contains a key code and the corresponding Key.
     static const KeyMap fn_key_map_;
 
-    static const KeyMap key_map_;
-
     // Code for function keys.
     static constexpr short kFnKey = 224;  
     static constexpr short kFKey  = 0;  
+#else
+    using SequenceMap = std::unordered_map<std::string, curs::Key>;
+
+    // Map for converting the escape sequences sent by function keys
+    // (without the leading ESC) to corresponding ncurses values.
+    static const SequenceMap sequence_map_;
+
+    // Time to wait for the rest of an escape sequence, in milliseconds.
+    // A lone ESC is the Escape key.
+    static constexpr int kEscapeDelay = 25;
+
+    std::string input_; // Bytes read from the terminal but not decoded yet.
+
+    // Appends the bytes available on the standard input to input_, waiting
+    // up to timeout milliseconds for them (forever if negative).
+    // Returns false if nothing was read.
+    bool ReadInput(int timeout);
+
+    // Returns the length of the escape sequence at the start of input_,
+    // or 0 if it is not complete.
+    std::size_t GetSequenceLength() const;
+#endif
 
     // Error code
     static constexpr short kErr = -1;
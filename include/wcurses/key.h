@@ -139,6 +139,7 @@ enum class Key {
   kInsert       = 331, // Insert key
   kPageDown     = 338, // Page Down
   kPageUp       = 339, // Page Up
+  kResize       = 410, // The terminal was resized
 };
 
 } // namespace curs
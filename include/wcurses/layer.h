@@ -0,0 +1,78 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WCURSES_LAYER_H_
+#define WCURSES_LAYER_H_
+
+#include "cell_grid.h"
+#include "structures.h"
+#include "window.h"
+
+namespace curs {
+
+namespace internal {
+class Compositor;
+} // namespace internal
+
+// The Layer class is a surface with cells of its own that is stacked above
+// the screen, like a panel: a pop-up, a menu or a modal dialog. What is
+// written to the screen below a layer is kept, and shows again when the
+// layer is hidden, moved or deleted, without being drawn anew.
+//
+// Text is written through the window of the layer, whose positions are
+// relative to the layer. Layers are merged into the screen by the next
+// Wcurses::Refresh, which only looks at the cells that changed.
+//
+// Layers are created with Wcurses::NewLayer and deleted with
+// Wcurses::DeleteLayer or by Endwin.
+class Layer {
+  public:
+    Layer(const Layer&) = delete;
+    Layer& operator=(const Layer&) = delete;
+
+    // Returns the window that covers the whole layer.
+    Window& GetWindow() { return window_; }
+
+    // Shows or hides the layer. A hidden layer keeps its contents.
+    void Show();
+    void Hide();
+    bool IsVisible() const { return is_visible_; }
+
+    // Moves the layer above or below all other layers.
+    void Raise();
+    void Lower();
+
+    // Moves the upper left corner of the layer to (y, x) on the screen.
+    // The parts of a layer past the edges of the screen are not shown.
+    void Move(short y, short x);
+
+    // Returns the rectangle the layer covers on the screen.
+    const Rect& GetRect() const { return rect_; }
+
+  private:
+    friend class internal::Compositor;
+
+    internal::Compositor* compositor_;
+    internal::CellGrid cells_;
+    Rect rect_;
+    bool is_visible_ = true;
+    Window window_;
+
+    Layer(internal::Compositor* compositor, internal::Buffer* buffer, const Rect& rect);
+};
+
+} // namespace curs
+
+#endif // WCURSES_LAYER_H_
@@ -0,0 +1,83 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+// Helpers that format numbers into caller-provided character arrays,
+// so that printing a number never allocates.
+
+#ifndef WCURSES_NUMBER_FORMAT_H_
+#define WCURSES_NUMBER_FORMAT_H_
+
+#include <cstddef>
+#include <type_traits>
+
+#include "structures.h"
+
+namespace curs {
+namespace internal {
+
+// Enough room for any 64-bit integer, including the sign.
+constexpr std::size_t kMaxIntegerLength = 20;
+
+// Enough room for any float or double in general notation, and for
+// fixed notation of values of reasonable magnitude.
+constexpr std::size_t kFloatBufferSize = 128;
+
+template <typename T>
+bool IsNegative(T value, std::true_type) { return value < 0; }
+
+template <typename T>
+bool IsNegative(T, std::false_type) { return false; }
+
+// Writes the decimal representation of value so that it ends right before
+// buffer_end, and returns a pointer to its first character.
+// The buffer must have room for kMaxIntegerLength characters.
+template <typename T>
+char* FormatInteger(T value, char* buffer_end) {
+  using UnsignedType = typename std::make_unsigned<T>::type;
+
+  const bool is_negative = IsNegative(value, std::is_signed<T>());
+
+  // Negate in unsigned arithmetic, which is also valid for the minimum value.
+  UnsignedType magnitude = is_negative
+      ? static_cast<UnsignedType>(0u - static_cast<UnsignedType>(value))
+      : static_cast<UnsignedType>(value);
+
+  char* first = buffer_end;
+
+  do {
+    *--first = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+
+  if (is_negative) {
+    *--first = '-';
+  }
+
+  return first;
+}
+
+// Formats value with the given number of digits after the decimal point
+// (fixed notation) or significant digits (general notation), like snprintf.
+// Returns the length of the full representation; if it is not less than
+// size, the output was truncated and a larger buffer is needed.
+std::size_t FormatFloat(double value, int precision, FloatFormat format,
+                        char* buffer, std::size_t size);
+std::size_t FormatFloat(long double value, int precision, FloatFormat format,
+                        char* buffer, std::size_t size);
+
+} // namespace internal
+} // namespace curs
+
+#endif // WCURSES_NUMBER_FORMAT_H_
@@ -0,0 +1,162 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WCURSES_PAD_H_
+#define WCURSES_PAD_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "cell_grid.h"
+#include "color_manager.h"
+#include "point.h"
+#include "structures.h"
+#include "unicode.h"
+
+namespace curs {
+
+class Wcurses;
+
+namespace internal {
+class Buffer;
+} // namespace internal
+
+// The Pad class holds text that is larger than the screen, such as a long
+// table, a log or a file listing, and is shown through a viewport: a
+// rectangle of the screen that Wcurses::DrawPad copies the visible part of
+// the pad into.
+//
+// Positions are long, so a pad may have millions of rows. The cells are
+// stored in chunks of kChunkRows by kChunkCols cells that are allocated when
+// one of their cells is first written; cells that were never written are
+// blank and take no memory. A pad therefore costs memory for the text it
+// holds, not for its size.
+//
+// Text is written like to a window: UTF-8, from the cursor, continued on
+// the next row at the right edge. Pads do not scroll.
+class Pad {
+  public:
+    static constexpr long kChunkRows = 8;
+    static constexpr long kChunkCols = 32;
+
+    // Creates a blank pad of rows by cols cells; both are at least 1.
+    Pad(long rows, long cols);
+
+    // Output stream operators, see the ones of Wcurses. Floating-point
+    // values are written with six digits after the decimal point.
+    Pad& operator<<(char ch);
+    Pad& operator<<(const char* str);
+    Pad& operator<<(const std::string& str);
+    Pad& operator<<(int val);
+    Pad& operator<<(long val);
+    Pad& operator<<(long long val);
+    Pad& operator<<(unsigned val);
+    Pad& operator<<(unsigned long val);
+    Pad& operator<<(unsigned long long val);
+    Pad& operator<<(double val);
+
+    // Outputs length characters starting at str.
+    Pad& Write(const char* str, std::size_t length);
+
+    // Moves the cursor of the pad, clamped to the pad.
+    void MoveTo(long y, long x);
+    const PointL& Getyx() const { return cursor_; }
+
+    // Sets the color pair of the characters written next. A pair that is not
+    // defined when the pad is drawn is drawn with the default pair.
+    void Attron(short pair_index) { pair_ = pair_index; }
+
+    // Resets the color pair to the default one.
+    void Attroff() { pair_ = internal::ColorManager::GetDefaultPair(); }
+
+    // Turns text attributes on or off for the characters written next.
+    void Attron(Attr attributes) { attributes_ = attributes_ | attributes; }
+    void Attroff(Attr attributes) { attributes_ = attributes_ & ~attributes; }
+
+    // Blanks the pad, releases its chunks and moves the cursor to the upper
+    // left corner.
+    void Clear();
+
+    // Getter methods
+    long GetRows() const { return rows_; }
+    long GetCols() const { return cols_; }
+    std::size_t GetChunkCount() const { return chunks_.size(); }
+
+  private:
+    friend class Wcurses;
+    friend class internal::Buffer;
+
+    using Chunk = std::unique_ptr<internal::ChType[]>;
+
+    long rows_;
+    long cols_;
+    long chunks_across_; // Number of chunks in a row of chunks.
+
+    // Allocated chunks by their number, counted row by row of chunks.
+    std::unordered_map<long long, Chunk> chunks_;
+
+    // The chunk found last, as writes and copies tend to stay in one chunk.
+    mutable long long cached_key_ = -1;
+    mutable internal::ChType* cached_chunk_ = nullptr;
+
+    internal::GraphemeTable graphemes_;
+
+    PointL cursor_ {0, 0};
+    Attr attributes_ = Attr::kNormal;
+    short pair_ = 0;
+
+    // Bytes of a UTF-8 sequence that was only written in part.
+    char utf8_pending_[internal::kMaxUtf8Length];
+    std::size_t utf8_pending_length_ = 0;
+
+    // Returns the chunk with the given number, or nullptr if it was never written.
+    internal::ChType* FindChunk(long long key) const;
+
+    // Returns the cells from (y, x) to the end of their row in the chunk,
+    // allocating the chunk if needed; *count receives their number.
+    internal::ChType* GetCells(long y, long x, long* count);
+
+    // Returns the cells from (y, x) on like GetCells for reading, or nullptr
+    // if they were never written or lie outside of the pad. *count receives
+    // the number of cells the result holds for.
+    const internal::ChType* FindCells(long y, long x, long* count) const;
+
+    // Returns the cell at (y, x), or a blank one if it was never written.
+    internal::ChType GetCell(long y, long x) const;
+
+    // Writes a character that is not ASCII at the cursor.
+    void PutCodePoint(char32_t code_point);
+
+    // Writes the character of the pending UTF-8 bytes once it is complete.
+    void PutPendingUtf8();
+
+    // Moves the cursor to the start of the next row; on the bottom row it
+    // stays where it is, like in a window.
+    void NewLine();
+
+    // Replaces a wide character that loses one half by writing the columns
+    // [begin, end) of row y with a blank.
+    void BreakWideCharacters(long y, long begin, long end);
+
+    // Formats a number on the stack and writes it.
+    template <typename T>
+    Pad& WriteInteger(T val);
+};
+
+} // namespace curs
+
+#endif // WCURSES_PAD_H_
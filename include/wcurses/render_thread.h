@@ -0,0 +1,105 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef WCURSES_RENDER_THREAD_H_
+#define WCURSES_RENDER_THREAD_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "cell_grid.h"
+#include "color_manager.h"
+#include "point.h"
+#include "renderer.h"
+#include "structures.h"
+#include "terminal.h"
+
+namespace curs {
+namespace internal {
+
+// The RenderThread class encodes and writes frames on a thread of its own,
+// so that a slow terminal does not block the thread that draws.
+// Publish copies the changes of the caller's grid into a pending grid and
+// returns; the thread then takes the pending changes, renders them with its
+// own Renderer and writes the frame. If the terminal falls behind, the
+// changes of several publishes accumulate in the pending grid, and only the
+// newest state is written once the terminal has taken the previous frame.
+// The terminal must not be written to by other threads unless Wait returned
+// and nothing was published since.
+class RenderThread {
+  public:
+    // The output counters continue from frame_stats.
+    RenderThread(Terminal& terminal, const FrameStats& frame_stats);
+
+    // Writes the pending frame, if any, and stops the thread.
+    ~RenderThread();
+
+    // Hands the changes of grid since its damage was last cleared over to
+    // the render thread. The caller clears the damage afterwards.
+    // Returns true if the previous frame was still pending and is merged
+    // into this one. Merges while the terminal is congested are counted as
+    // dropped frames instead, and return false.
+    bool Publish(const CellGrid& grid, const ColorManager& color_manager,
+                 const Point& cursor, bool cursor_visible);
+
+    // Makes the next frame repaint every cell.
+    void Invalidate();
+
+    // Selects the optional sequences the frames may use, from the next frame on.
+    void SetCapabilities(const Capabilities& capabilities);
+
+    // Blocks until every published frame is written.
+    void Wait();
+
+    // Returns the output counters of the frames written so far.
+    FrameStats GetFrameStats() const;
+
+  private:
+    Terminal& terminal_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable frame_ready_; // Signaled on publish and on stop.
+    std::condition_variable frame_done_;  // Signaled after every written frame.
+
+    // Guarded by mutex_.
+    CellGrid pending_grid_; // Everything published, damaged since taken last.
+    ColorManager pending_colors_;
+    Point pending_cursor_ {0, 0};
+    bool is_cursor_visible_ = true;
+    bool is_frame_pending_ = false;
+    bool is_rendering_ = false;
+    bool is_stalled_ = false; // Waiting for the terminal to take a frame.
+    bool is_invalidate_pending_ = false;
+    bool is_stopping_ = false;
+    Capabilities capabilities_;
+    FrameStats frame_stats_;
+
+    // Used by the render thread only.
+    CellGrid grid_;
+    ColorManager color_manager_;
+    Renderer renderer_;
+
+    std::thread thread_;
+
+    // The loop of the render thread.
+    void Run();
+};
+
+} // namespace internal
+} // namespace curs
+
+#endif // WCURSES_RENDER_THREAD_H_
@@ -0,0 +1,173 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WCURSES_RENDERER_H_
+#define WCURSES_RENDERER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "cell_grid.h"
+#include "color_manager.h"
+#include "point.h"
+#include "structures.h"
+#include "unicode.h"
+
+namespace curs {
+namespace internal {
+
+// The Renderer class converts the contents of a CellGrid into the text that
+// brings the terminal up to date. It keeps a copy of the last rendered frame
+// (the front grid) and only emits the runs of cells that differ from it.
+// The renderer tracks where the terminal cursor is and reaches each run the
+// cheapest way: an absolute position, relative moves, a carriage return and
+// line feeds, or by rewriting the unchanged cells in between. Runs of equal
+// cells are sent as repeat or erase sequences when the terminal has them.
+// Scrolls recorded in the grid are repeated with the terminal's own scrolling
+// sequences, so rows that only moved are not repainted.
+// A frame is complete terminal output that ends with the cursor at its final
+// position, so it can be written with a single call. Only large frames hide
+// the cursor while cells are drawn. An unchanged frame produces no output.
+//
+// The frame is a list of segments: slices of the renderer's own output
+// buffer, and escape sequences that already exist elsewhere (constants and
+// long color codes of the ColorManager), which are referenced instead of
+// copied. The segments stay valid until the next Render or until the colors
+// of the ColorManager change, and can be written with one vectored write.
+class Renderer {
+  public:
+    using ScreenBufferType = std::string;
+
+    // Builds the output for the given grid. Only rows marked as damaged in
+    // the grid are compared with the front grid; the damage itself is left
+    // for the caller to clear. The frame leaves the terminal cursor at
+    // cursor, visible if cursor_visible is true.
+    void Render(const CellGrid& grid, const ColorManager& color_manager,
+                const Point& cursor, bool cursor_visible);
+
+    // Forgets what is on the terminal, so the next frame repaints every cell.
+    void Invalidate();
+
+    // Enables or disables escape sequences for cursor positioning.
+    // Without them every frame contains the whole screen, row by row, and
+    // must be written starting from the upper left corner.
+    void SetEscapeSequences(bool enable);
+
+    // Selects the optional sequences the output may use.
+    void SetCapabilities(const Capabilities& capabilities) { capabilities_ = capabilities; }
+
+    // Getter methods
+    const std::vector<FrameSegment>& GetFrameSegments() const { return segments_; }
+    std::size_t GetFrameSize() const { return frame_size_; }
+    bool IsUsingEscapeSequences() const { return use_escape_sequences_; }
+    const Capabilities& GetCapabilities() const { return capabilities_; }
+
+  private:
+    // Color pair that never appears in a grid, marks unknown cells and state.
+    static constexpr ColorManager::PairIndex kUnknownPair = -1;
+
+    // Attributes that never appear in a grid, mark the unknown state.
+    static constexpr Attr kUnknownAttributes = static_cast<Attr>(0xff);
+
+    // Upper bound for the number of segments of a frame; further color codes
+    // are copied, so a frame always fits into a single vectored write.
+    static constexpr std::size_t kMaxSegments = 64;
+
+    // Segments a color code reference needs besides those already recorded:
+    // the slice before it, the reference itself, the slice that ends the
+    // frame and the sequences that hide and show the cursor.
+    static constexpr std::size_t kReservedSegments = 5;
+
+    ScreenBufferType screen_buffer_; // The bytes of the frame that are not referenced.
+    std::vector<FrameSegment> segments_;
+    std::size_t slice_begin_ = 0; // Bytes of screen_buffer_ from here on are not in segments_ yet.
+    std::size_t frame_size_ = 0;
+    CellGrid front_; // What the terminal shows after the last frame.
+    ColorManager::PairIndex current_pair_ = kUnknownPair; // Last pair sent to the terminal.
+    Attr current_attributes_ = kUnknownAttributes; // Last attributes sent to the terminal.
+    // Position of the terminal cursor, -1 if unknown. A column equal to the
+    // width means the cursor waits at the right margin to wrap.
+    short cursor_y_ = -1;
+    short cursor_x_ = -1;
+    unsigned color_generation_ = 0; // Color generation the front grid was drawn with.
+    bool is_front_valid_ = false;
+    bool use_escape_sequences_ = true;
+    bool is_color_active_ = false; // Whether the frame being built sets colors.
+    Capabilities capabilities_;
+
+    // Draws the changed cells of the damaged rows.
+    void RenderCells(const CellGrid& grid, const ColorManager& color_manager);
+
+    // Builds the whole screen without cursor positioning.
+    void RenderFullFrame(const CellGrid& grid, const ColorManager& color_manager);
+
+    // Appends the shortest output that moves the cursor to (y, x).
+    void AppendCursorMove(short y, short x);
+
+    // Appends the escape sequence that moves the cursor to (y, x).
+    void AppendCursorPosition(short y, short x);
+
+    // Sends the run of equal cells that starts at x on row y with a repeat or
+    // erase sequence, if that is shorter than the changed cells it covers.
+    // changed is the number of changed cells that start at x.
+    // Returns the column after the run, or x if the run was not sent.
+    short AppendEqualCells(const ChType* back_row, short y, short x, short changed);
+
+    // Appends the UTF-8 text of a cell symbol.
+    void AppendSymbol(const GraphemeTable& graphemes, char32_t symbol);
+
+    // Appends "\033[<count><final_byte>", leaving out a count of 1.
+    void AppendSequence(int count, char final_byte);
+
+    // Moves the cursor right on row y, from column from to column to, with a
+    // relative move or by rewriting the cells in between.
+    void AppendForward(short y, short from, short to);
+    std::size_t GetForwardLength(short y, short from, short to) const;
+
+    // Whether the cells between from and to are shown on the terminal in
+    // the current colors and attributes, so writing them again changes nothing.
+    bool IsRewritable(short y, short from, short to) const;
+
+    // Appends the escape sequences that scroll a region of the terminal.
+    void AppendScroll(const ScrollOp& scroll, short rows);
+
+    // Appends the escape sequence that switches the terminal to the pair.
+    void AppendColor(const ColorManager& color_manager, ColorManager::PairIndex pair);
+
+    // Appends the escape sequence that switches the terminal to the
+    // attributes and the pair of the cell. Attributes are turned on and off
+    // one by one, unless a reset of everything is shorter.
+    void AppendStyle(const ColorManager& color_manager, const ChType& cell);
+
+    // Adds bytes that stay valid for the lifetime of the frame as a segment
+    // of their own.
+    void AppendReference(const char* data, std::size_t size);
+
+    // Turns the bytes of screen_buffer_ added since the last segment into one.
+    void CloseSlice();
+
+    // Resolves the segments of screen_buffer_, which may have moved while
+    // the frame was built, and sums up the frame size.
+    void FinishFrame();
+
+    // Appends the decimal representation of a number.
+    void AppendNumber(int value);
+};
+
+} // namespace internal
+} // namespace curs
+
+#endif // WCURSES_RENDERER_H_
@@ -0,0 +1,61 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WCURSES_SNAPSHOT_H_
+#define WCURSES_SNAPSHOT_H_
+
+#include <string>
+#include <utility>
+
+#include "cell_grid.h"
+#include "structures.h"
+
+namespace curs {
+
+class Wcurses;
+
+// The Snapshot class holds the screen as it was when Wcurses::TakeSnapshot
+// was called, e.g. for undo, to put back what a transient overlay drew over,
+// or to give another thread a frame that does not change while it is read.
+//
+// A snapshot shares the rows of the screen and copies a row only when the
+// screen is about to change it, so taking one is cheap even for a large
+// screen and every frame. Copies of a Snapshot refer to the same cells.
+class Snapshot {
+  public:
+    // Creates an empty snapshot, which restores nothing.
+    Snapshot() = default;
+
+    // Returns false for an empty snapshot.
+    bool IsValid() const { return snapshot_.IsValid(); }
+
+    // Returns the size of the screen when the snapshot was taken.
+    Size GetSize() const { return snapshot_.GetSize(); }
+
+    // Returns the UTF-8 text of row y as it was; a wide character appears
+    // once. May be called from any thread.
+    std::string GetRowText(short y) const { return snapshot_.GetRowText(y); }
+
+  private:
+    friend class Wcurses;
+
+    internal::GridSnapshot snapshot_;
+
+    explicit Snapshot(internal::GridSnapshot snapshot) : snapshot_(std::move(snapshot)) {}
+};
+
+} // namespace curs
+
+#endif // WCURSES_SNAPSHOT_H_
@@ -16,11 +16,21 @@
 #ifndef WCURSES_STRUCTURES_H_
 #define WCURSES_STRUCTURES_H_
 
+#include <cstddef>
+
 namespace curs {
   struct Size {
     short rows;
     short cols;
   };
+
+  // A rectangle of cells: the upper left corner and the size.
+  struct Rect {
+    short y;
+    short x;
+    short rows;
+    short cols;
+  };
   
   struct ColorPair {
     short foreground = 0;
@@ -32,6 +42,77 @@ namespace curs {
     short green;
     short blue;
   };
+
+  // Text attributes of a cell, combined with |.
+  enum class Attr : unsigned char {
+    kNormal    = 0,
+    kBold      = 1 << 0,
+    kDim       = 1 << 1,
+    kItalic    = 1 << 2,
+    kUnderline = 1 << 3,
+    kBlink     = 1 << 4,
+    kReverse   = 1 << 5
+  };
+
+  constexpr Attr operator|(Attr lhs, Attr rhs) {
+    return static_cast<Attr>(static_cast<unsigned char>(lhs) | static_cast<unsigned char>(rhs));
+  }
+
+  constexpr Attr operator&(Attr lhs, Attr rhs) {
+    return static_cast<Attr>(static_cast<unsigned char>(lhs) & static_cast<unsigned char>(rhs));
+  }
+
+  constexpr Attr operator~(Attr attr) {
+    return static_cast<Attr>(static_cast<unsigned char>(~static_cast<unsigned char>(attr)));
+  }
+
+  // Notation used to output floating-point values.
+  enum class FloatFormat {
+    kFixed,   // Fixed number of digits after the decimal point ("%f").
+    kGeneral  // Fixed number of significant digits ("%g").
+  };
+
+  // Implementation behind Wcurses on Unix-like systems.
+  enum class Backend {
+    kNcurses, // Forwards every call to ncurses.
+    kNative,  // Renders through the library's own buffer with ANSI escape sequences.
+    kHeadless // Like kNative, but into an in-memory virtual terminal, without a console.
+  };
+
+  // Optional sequences used to shorten the output of the native backend.
+  // Terminals that lack one of them can turn it off with Wcurses::SetCapabilities.
+  struct Capabilities {
+    bool repeat = true; // REP ("\033[<n>b") repeats the previous character.
+    bool erase = true;  // ECH and EL erase cells with the current background color.
+  };
+
+  // Colors the terminal can show. Colors beyond the depth are replaced with
+  // the nearest color the terminal has.
+  enum class ColorDepth {
+    kTrueColor, // RGB custom colors ("\033[38;2;<r>;<g>;<b>m") and the 256-color palette.
+    k256,       // The 256-color palette ("\033[38;5;<n>m").
+    k16,        // The 8 basic colors and their bright variants ("\033[31m", "\033[91m").
+    kMonochrome // No colors at all.
+  };
+
+  // A read-only piece of an encoded frame. Written in order, the segments
+  // of a frame are its complete output.
+  struct FrameSegment {
+    const char* data;
+    std::size_t size;
+  };
+
+  // Counters for the output written to the terminal by Refresh.
+  struct FrameStats {
+    unsigned long long frames = 0;   // Refreshes that wrote to the terminal.
+    unsigned long long bytes = 0;    // Bytes of frame output in total.
+    unsigned long long syscalls = 0; // Output calls to the operating system in total.
+    unsigned long long coalesced = 0; // Refreshes merged into a later frame.
+    unsigned long long dropped = 0;  // Refreshes skipped while the terminal had not taken the previous frame.
+    unsigned long long stalls = 0;   // Writes that found the terminal's output buffer full.
+    unsigned long last_frame_bytes = 0;
+    unsigned long last_frame_syscalls = 0;
+  };
 } // namespace curs
 
 #endif // WCURSES_STRUCTURES_H_
\ No newline at end of file
@@ -13,20 +13,28 @@
 // You should have received a copy of the GNU General Public License
 // along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
 
-#ifdef _WIN32
-
 #ifndef WCURSES_TERMINAL_H_
 #define WCURSES_TERMINAL_H_
 
-#include <Windows.h>
+#ifdef _WIN32
+  #include <Windows.h>
+#else
+  #include <signal.h>
+  #include <termios.h>
+#endif
 
+#include <cstddef>
+#include <memory>
 #include <string>
 
 #include "point.h"
+#include "structures.h"
+#include "virtual_terminal.h"
 
 namespace curs {
 namespace internal {
 
+#ifdef _WIN32
 // The Terminal class for managing a terminal on Windows.
 // This class provides methods for customizing the terminal: resizing, fonts,
 // cursor control, and other window parameters.
@@ -88,18 +96,183 @@ class Terminal {
     bool GetCursorVisible() const { return cursor_visibility_; }
     bool IsVirtualModeEnabled() const { return is_virtual_mode_enabled; }
 
+    // Consoles that interpret escape sequences show RGB colors.
+    ColorDepth GetColorDepth() const {
+      return is_virtual_mode_enabled ? ColorDepth::kTrueColor : ColorDepth::kMonochrome;
+    }
+
+    // Returns the number of console API calls that changed the screen so far.
+    unsigned long long GetSyscallCount() const { return syscall_count_; }
+
+    // The console takes all output at once: frames are written right away
+    // and output is never pending. The segments of a frame are joined for
+    // a single console call.
+    bool WriteFrame(const FrameSegment* segments, std::size_t count);
+    bool SendPendingOutput() { return true; }
+    void DrainOutput() {}
+    bool WaitWritable(int) { return true; }
+    unsigned long long GetStallCount() const { return 0; }
+    bool HasPendingOutput() const { return false; }
+
   private:
     HANDLE terminal_handle_;
     HWND terminal_window_;
     DWORD terminal_mode_;
+    UINT output_code_page_; // Code page to restore at the end.
 
     bool cursor_visibility_;
     bool is_virtual_mode_enabled;
-    
+
+    unsigned long long syscall_count_ = 0;
+
+    std::string frame_output_; // Joined segments of a frame, its capacity is reused.
 }; 
+#else
+// The Terminal class for managing a terminal on Unix-like systems.
+// The terminal is switched to the alternate screen and to unbuffered input
+// without echo for the lifetime of the object, or until RestoreTerminalMode.
+// All output goes to the terminal of the standard output as ANSI escape
+// sequences.
+//
+// Output goes through a non-blocking description of the terminal opened
+// for this object, so the flags of the standard output, which it shares
+// with the shell, stay untouched. Frames are written with WriteFrame, which
+// keeps what a slow terminal cannot take yet as pending output instead of
+// waiting; the other output methods block until the pending output and
+// their own output are written. When the standard output is not a
+// terminal, it is written to directly and every write blocks.
+//
+// Output to a terminal that is gone (hung up, or failing with errors other
+// than a full buffer) is dropped instead of being kept as pending output.
+//
+// A headless terminal has no device at all: its output is interpreted by
+// a VirtualTerminal, and there is no input.
+class Terminal {
+  public:
+    Terminal();
+    explicit Terminal(Size headless_size);
+    ~Terminal();
+
+    // Outputs the given string to the terminal.
+    Terminal& operator<<(const std::string& str);
+
+    // Outputs the given character to the terminal.
+    Terminal& operator<<(char ch);
+
+    // Outputs length bytes starting at data, retrying interrupted and partial writes.
+    void Write(const char* data, std::size_t length);
+
+    // Outputs the segments of a frame with one vectored write, as far as the
+    // terminal takes them without waiting, and keeps the rest as pending
+    // output. Returns true if nothing is left pending.
+    bool WriteFrame(const FrameSegment* segments, std::size_t count);
+
+    // Writes as much of the pending output as the terminal takes without
+    // waiting. Returns true if no pending output is left.
+    bool SendPendingOutput();
+
+    // Blocks until the pending output is written.
+    void DrainOutput();
+
+    // Waits up to timeout milliseconds (-1 for no limit) until the terminal
+    // takes more output, or hung up, which drops the pending output.
+    // Returns false on timeout or interruption.
+    bool WaitWritable(int timeout);
+
+    // Clears the terminal screen.
+    void ClearScreen();
+
+    // Resets the cursor to its default position.
+    void ResetCursor();
+
+    // Moves the cursor to the specified position through the Point structure.
+    void MoveCursor(const Point& cursor);
+
+    // Use the MoveCursor method with two parameters (y, x) for convenience.
+    void MoveCursor(short y, short x);
+
+    // Sets the terminal window title.
+    void SetTitle(const std::string& title);
+
+    // Sets the visibility of the cursor
+    void SetCursorVisible(bool visible);
+
+    // Leaves the alternate screen and restores the original terminal mode.
+    void RestoreTerminalMode();
+
+    // Returns true once for every series of size changes of the terminal
+    // window (SIGWINCH) since the previous call.
+    bool WasResized();
+
+    // Returns the current size of the terminal
+    // Returns a Point structure with the current height and width
+    Point GetSize() const;
+
+    // Returns the colors the terminal shows, as announced by the COLORTERM
+    // and TERM environment variables.
+    ColorDepth GetColorDepth() const;
+
+    bool GetCursorVisible() const { return cursor_visibility_; }
+
+    // Escape sequences are always interpreted by the terminal.
+    bool IsVirtualModeEnabled() const { return true; }
+
+    // Returns the number of write calls made so far.
+    unsigned long long GetSyscallCount() const { return syscall_count_; }
+
+    // Returns the number of writes that found the output buffer of the
+    // terminal full so far.
+    unsigned long long GetStallCount() const { return stall_count_; }
+
+    bool HasPendingOutput() const { return pending_offset_ < pending_output_.size(); }
+
+    // Returns the virtual terminal of a headless terminal, nullptr otherwise.
+    const VirtualTerminal* GetVirtualTerminal() const { return virtual_terminal_.get(); }
+
+  private:
+    // Frames have few segments, more than this are written in batches.
+    static constexpr std::size_t kMaxVectors = 64;
+
+    int output_fd_;
+    int input_fd_;
+
+    termios terminal_mode_; // Mode to restore at the end.
+    struct sigaction resize_action_; // SIGWINCH handler to restore at the end.
+    bool is_output_owned_; // output_fd_ is a non-blocking description opened here.
+
+    bool cursor_visibility_;
+    bool is_raw_mode_enabled_;
+    bool is_active_; // The terminal mode has not been restored yet.
+
+    std::unique_ptr<VirtualTerminal> virtual_terminal_; // Only when headless.
+
+    // Output the terminal did not take yet, starting at pending_offset_.
+    std::string pending_output_;
+    std::size_t pending_offset_ = 0;
+
+    unsigned long long syscall_count_ = 0;
+    unsigned long long stall_count_ = 0;
+
+    // The error of the write call that stopped the last WriteSome, or 0 if
+    // it stopped after a partial write without an error.
+    int write_error_ = 0;
+
+    // Write as much as the terminal takes without waiting and return the
+    // number of bytes written.
+    std::size_t WriteSome(const char* data, std::size_t length);
+    std::size_t WriteSome(const FrameSegment* segments, std::size_t count);
+
+    // Returns true if the last WriteSome stopped on an error that means the
+    // terminal takes no more output, rather than a full buffer or a partial
+    // write.
+    bool IsOutputGone() const;
+
+    // Forgets the pending output.
+    void DiscardPendingOutput();
+};
+#endif // _WIN32
 
 } // namespace internal
 } // namespace curs
 
-#endif // WCURSES_TERMINAL_H_
-#endif // _WIN32
\ No newline at end of file
+#endif // WCURSES_TERMINAL_H_
\ No newline at end of file
@@ -0,0 +1,111 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+// UTF-8 decoding and encoding, the display width of characters, and the
+// table of characters made of several code points.
+
+#ifndef WCURSES_UNICODE_H_
+#define WCURSES_UNICODE_H_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace curs {
+namespace internal {
+
+// Stands for bytes that are not valid UTF-8.
+constexpr char32_t kReplacementCharacter = 0xfffd;
+
+// Upper bound for the length of a UTF-8 encoded code point.
+constexpr std::size_t kMaxUtf8Length = 4;
+
+// The symbol of a cell is a code point, or one of the values above the last
+// code point: the right half of a wide character, or an entry of a GraphemeTable.
+constexpr char32_t kMaxCodePoint = 0x10ffff;
+constexpr char32_t kWideContinuation = kMaxCodePoint + 1;
+constexpr char32_t kFirstGrapheme = kMaxCodePoint + 2;
+
+// Looks a code point up in the width table, see GetCharWidth.
+int LookUpCharWidth(char32_t code_point);
+
+// Returns the number of columns a code point takes on a terminal: 0 for
+// combining characters, 2 for wide (East Asian and emoji) characters and
+// 1 otherwise. The characters before the first combining mark are answered
+// without a lookup; the Basic Multilingual Plane is covered by a table of
+// two bits per code point that is computed once.
+inline int GetCharWidth(char32_t code_point) {
+  return code_point < 0x300 ? 1 : LookUpCharWidth(code_point);
+}
+
+// Decodes the UTF-8 sequence at the start of the length bytes at data into
+// code_point and returns its length. Invalid bytes decode to
+// kReplacementCharacter one at a time. Returns 0 if the bytes end in the
+// middle of a sequence.
+std::size_t DecodeUtf8(const char* data, std::size_t length, char32_t* code_point);
+
+// Writes the UTF-8 encoding of a code point to out, which must have room for
+// kMaxUtf8Length bytes, and returns its length.
+std::size_t EncodeUtf8(char32_t code_point, char* out);
+
+// Returns true for the regional indicator symbols, two of which form a flag.
+inline bool IsRegionalIndicator(char32_t code_point) {
+  return code_point >= 0x1f1e6 && code_point <= 0x1f1ff;
+}
+
+class GraphemeTable;
+
+// Returns true if code_point continues the character of the symbol previous
+// although it has a width of its own: it follows a zero width joiner, or
+// it is the second half of a flag. graphemes holds the text of previous.
+bool JoinsPrevious(const GraphemeTable& graphemes, char32_t previous, char32_t code_point);
+
+// The GraphemeTable class interns characters that consist of several code
+// points (a base character with combining marks, emoji sequences, flags), so
+// that a cell holds them in a single symbol. Entries are never removed: the
+// symbols stay valid for the lifetime of the table, and a copy is brought up
+// to date by appending the entries added since.
+class GraphemeTable {
+  public:
+    // Upper bound for the number of entries. A full table keeps the base
+    // character of new entries and drops the rest.
+    static constexpr std::size_t kMaxEntries = 1 << 16;
+
+    // Returns the symbol of the UTF-8 text of a character, adding it on first use.
+    char32_t Intern(const std::string& text);
+
+    // Returns the symbol of the character symbol, a code point or a symbol
+    // returned by Intern, followed by code_point.
+    char32_t Append(char32_t symbol, char32_t code_point);
+
+    // Returns the UTF-8 text of a symbol returned by Intern.
+    const std::string& GetText(char32_t symbol) const { return entries_[symbol - kFirstGrapheme]; }
+
+    // Appends the entries of source beyond the size of this table. source
+    // must be a table that this one was copied from.
+    void CopyNewEntries(const GraphemeTable& source);
+
+    std::size_t GetSize() const { return entries_.size(); }
+
+  private:
+    std::vector<std::string> entries_;
+    std::unordered_map<std::string, char32_t> symbols_;
+};
+
+} // namespace internal
+} // namespace curs
+
+#endif // WCURSES_UNICODE_H_
@@ -0,0 +1,191 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef WCURSES_VIRTUAL_TERMINAL_H_
+#define WCURSES_VIRTUAL_TERMINAL_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "point.h"
+#include "structures.h"
+
+namespace curs {
+namespace internal {
+
+// A cell of the virtual screen.
+struct VirtualCell {
+  char32_t symbol = U' ';
+  int foreground = -1; // VirtualTerminal::kDefaultColor, a palette index or an RGB color.
+  int background = -1;
+  unsigned char attributes = 0; // VirtualTerminal::Attribute flags.
+};
+
+inline bool operator==(const VirtualCell& lhs, const VirtualCell& rhs) {
+  return lhs.symbol == rhs.symbol && lhs.foreground == rhs.foreground &&
+         lhs.background == rhs.background && lhs.attributes == rhs.attributes;
+}
+
+inline bool operator!=(const VirtualCell& lhs, const VirtualCell& rhs) {
+  return !(lhs == rhs);
+}
+
+// Counters of the output consumed by a VirtualTerminal.
+struct VirtualTerminalStats {
+  unsigned long long bytes = 0;     // Bytes written.
+  unsigned long long writes = 0;    // Calls to Write.
+  unsigned long long sequences = 0; // Escape sequences interpreted.
+  unsigned long long printed = 0;   // Characters put on the screen.
+  unsigned long long unknown = 0;   // Escape sequences that were ignored.
+};
+
+// The VirtualTerminal class is an in-memory terminal: it interprets the
+// byte stream a real terminal would receive (UTF-8 text, control characters
+// and the ANSI escape sequences for cursor movement, colors and attributes,
+// erasing, scroll regions and scrolling) into a grid of cells.
+// It allows the output of the library to be measured and compared without
+// a console.
+class VirtualTerminal {
+  public:
+    // Color of cells whose color was never set or was reset.
+    static constexpr int kDefaultColor = -1;
+
+    // Flag of colors given as 24-bit RGB; the lower 24 bits hold 0xRRGGBB.
+    // Other colors are 256-color palette indices.
+    static constexpr int kRgbColor = 1 << 24;
+
+    // Text attributes of a cell.
+    enum Attribute : unsigned char {
+      kBold      = 1 << 0,
+      kDim       = 1 << 1,
+      kItalic    = 1 << 2,
+      kUnderline = 1 << 3,
+      kBlink     = 1 << 4,
+      kReverse   = 1 << 5,
+    };
+
+    explicit VirtualTerminal(Size size);
+
+    // Interprets length bytes of terminal output. Sequences may be split
+    // across calls.
+    void Write(const char* data, std::size_t length);
+    VirtualTerminal& operator<<(const std::string& str);
+
+    // Changes the size of the screen, keeping the overlapping cells.
+    void Resize(Size size);
+
+    // Blanks the screen and resets the cursor, the colors and the scroll region.
+    // The counters are kept.
+    void Reset();
+
+    void ResetStats() { stats_ = VirtualTerminalStats(); }
+
+    // Returns the cell at the given position.
+    const VirtualCell& At(short y, short x) const { return cells_[y * size_.cols + x]; }
+
+    // Returns the symbols of row y as UTF-8 text.
+    std::string GetRowText(short y) const;
+
+    // Getter methods
+    const Size& GetSize() const { return size_; }
+    Point GetCursor() const { return {cursor_y_, cursor_x_}; }
+    bool IsCursorVisible() const { return is_cursor_visible_; }
+    const VirtualTerminalStats& GetStats() const { return stats_; }
+
+  private:
+    // States of the escape sequence parser.
+    enum class State {
+      kGround,             // Text and control characters.
+      kEscape,             // After ESC.
+      kEscapeIntermediate, // After ESC and an intermediate byte, e.g. "ESC (".
+      kCsi,                // Control sequence: ESC [ ...
+      kOsc,                // Operating system command: ESC ] ... BEL or ST.
+      kOscEscape           // ESC inside an operating system command.
+    };
+
+    static constexpr int kMaxParameters = 16;
+
+    Size size_;
+    std::vector<VirtualCell> cells_;
+
+    short cursor_y_ = 0;
+    short cursor_x_ = 0;
+    bool is_pending_wrap_ = false; // A character was printed in the last column.
+    short saved_y_ = 0;
+    short saved_x_ = 0;
+    short scroll_top_ = 0;
+    short scroll_bottom_ = 0;
+    bool is_cursor_visible_ = true;
+
+    VirtualCell pen_; // Colors and attributes of the characters printed next.
+    char32_t last_symbol_ = U' '; // Repeated by REP.
+    char32_t previous_code_point_ = 0; // Last code point printed, joined or not.
+    bool is_flag_open_ = false; // The last character is the first half of a flag.
+
+    State state_ = State::kGround;
+    int parameters_[kMaxParameters];
+    int parameter_count_ = 0;
+    char private_marker_ = 0; // '?' of private sequences such as "ESC [ ? 25 h".
+
+    char32_t code_point_ = 0; // UTF-8 sequence being decoded.
+    int utf8_remaining_ = 0;
+
+    VirtualTerminalStats stats_;
+
+    VirtualCell& Cell(short y, short x) { return cells_[y * size_.cols + x]; }
+
+    // Returns parameter i, or fallback if it is missing or 0.
+    int Parameter(int i, int fallback) const {
+      return i < parameter_count_ && parameters_[i] > 0 ? parameters_[i] : fallback;
+    }
+
+    void Consume(unsigned char byte);
+    void ConsumeText(unsigned char byte);
+    void ConsumeEscape(unsigned char byte);
+    void ConsumeCsi(unsigned char byte);
+
+    // Interprets a complete sequence.
+    void ExecuteEscape(unsigned char final_byte);
+    void ExecuteCsi(unsigned char final_byte);
+    void ExecuteSgr();
+    void ExecuteControl(unsigned char byte);
+
+    // Puts a character at the cursor and advances it by its width, wrapping at
+    // the end of a row. The right half of a wide character is a cell with the
+    // symbol kWideContinuation.
+    void Print(char32_t symbol);
+
+    // Moves the cursor down a row, scrolling at the bottom of the scroll region.
+    void LineFeed();
+
+    // Moves the cursor, clamped to the screen.
+    void MoveCursor(int y, int x);
+
+    // Scrolls the rows [top, bottom] up by count rows (down if negative).
+    void ScrollRows(short top, short bottom, int count);
+
+    // Blanks the cells [begin, end) of row y with the current background.
+    void Erase(short y, short begin, short end);
+
+    // Returns a blank cell with the current background.
+    VirtualCell Blank() const;
+};
+
+} // namespace internal
+} // namespace curs
+
+#endif // WCURSES_VIRTUAL_TERMINAL_H_
@@ -18,7 +18,9 @@
 //
 // The Wcurses library implements partial ncurses functionality for Windows, allowing 
 // the creation of text-based interfaces in the terminal. On Unix systems, it acts as a 
-// wrapper around ncurses, providing a unified interface for terminal operations.  
+// wrapper around ncurses by default, providing a unified interface for terminal operations.  
+// Initialized with Backend::kNative, it uses the same buffered renderer as on Windows
+// instead, writing ANSI escape sequences to the standard output.
 //
 // Features:
 // - On Windows, the library uses <windows.h> to interact with the terminal API and 
@@ -33,16 +35,31 @@
 
 #ifdef _WIN32
   #include <sstream>
+#endif // _WIN32
 
-  #include "buffer.h"
-  #include "color_manager.h"
-  #include "input_manager.h"
-  #include "terminal.h"
-#else
+#include "buffer.h"
+#include "color_manager.h"
+#include "input_manager.h"
+#include "layer.h"
+#include "pad.h"
+#include "render_thread.h"
+#include "snapshot.h"
+#include "terminal.h"
+#include "virtual_terminal.h"
+#include "window.h"
+
+#ifndef _WIN32
   #include <ncurses.h>
 #endif // _WIN32
 
+#include <chrono>
+#include <cstddef>
 #include <string>
+#include <vector>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+  #include <string_view>
+#endif
 
 #include "wcurses/key.h"
 #include "wcurses/point.h"
@@ -63,13 +80,21 @@ class Wcurses {
     void Initscr(Size size);
     void Initscr(short rows, short cols) { Initscr({rows, cols}); }
 #else
-    // Initializes the library (Unix-based systems).
-    void Initscr();
+    // Initializes the library (Unix-based systems) with the given backend.
+    // The native backend fills the whole terminal and follows its size.
+    void Initscr(Backend backend = Backend::kNcurses) { Initscr({0, 0}, backend); }
 
     // These methods ensure a unified interface for Windows and Linux.
-    // On Linux, they simply initialize the library without changing the terminal size.
-    void Initscr(Size) { Initscr(); }
-    void Initscr(short, short) { Initscr(); }
+    // On Linux, the size is only used by the headless backend (80x24 by default);
+    // the other backends use the size of the terminal.
+    void Initscr(Size size, Backend backend = Backend::kNcurses);
+    void Initscr(short rows, short cols, Backend backend = Backend::kNcurses) {
+      Initscr({rows, cols}, backend);
+    }
+
+    // Returns the virtual terminal of the headless backend, nullptr otherwise.
+    // It is destroyed by Endwin.
+    const internal::VirtualTerminal* GetVirtualTerminal() const;
 #endif
 
     // Ends the terminal session.
@@ -92,12 +117,21 @@ class Wcurses {
     Wcurses& operator<<(long double val);
     Wcurses& operator<<(Wcurses& (*pf)(Wcurses&));
 
+    // Sets the number of digits used for floating-point output: digits after
+    // the decimal point in fixed notation, significant digits in general
+    // notation. The default is six digits in fixed notation.
+    void SetPrecision(int precision);
+    void SetFloatFormat(FloatFormat format);
+
+    // Outputs length characters starting at str, without looking for a terminator.
+    Wcurses& Write(const char* str, std::size_t length);
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+    Wcurses& operator<<(std::string_view str) { return Write(str.data(), str.size()); }
+#endif
+
     // Returns the error value (-1).
-    #ifdef _WIN32
-      short Err() { return internal::InputManager::Err(); }
-    #else
-      short Err() { return ERR; }
-    #endif
+    short Err() { return internal::InputManager::Err(); }
 
     // Overloaded input stream operators.
     Wcurses& operator>>(int& val);
@@ -115,9 +149,52 @@ class Wcurses {
     // Clears any pending input.
     void FlushInput();
 
-    // Refreshes the screen to reflect changes.
+    // Refreshes the screen to reflect changes. With escape sequences the
+    // whole frame, cursor included, is sent to the terminal in one write.
+    // With a frame rate set, the screen is only marked as pending and drawn
+    // once the frame interval has passed, by Refresh, Sleep or GetCh.
+    // Output is never waited for: while the terminal has not taken the
+    // previous frame, the screen stays pending as well, and only the newest
+    // state is sent once the terminal catches up.
     void Refresh();
 
+    // Draws the screen immediately, regardless of the frame rate, unless the
+    // terminal has not taken the previous frame yet. Useful for
+    // latency-critical output such as echoing a keystroke.
+    void Flush();
+
+    // Moves the encoding and writing of frames to a separate thread (native
+    // backend and escape sequences only), so that Refresh returns without
+    // waiting for the terminal. If the terminal falls behind, only the newest
+    // screen is written. Returns false if this is not supported.
+    bool SetAsyncRendering(bool enable);
+
+    // Limits the drawing to the given number of frames per second: the
+    // refreshes made within a frame interval produce a single frame.
+    // 0 (the default) draws on every Refresh.
+    void SetFrameRate(unsigned frames_per_second);
+
+    // Selects the optional sequences that shorten the output (see Capabilities).
+    // All are used by default; turn off the ones the terminal does not support.
+    void SetCapabilities(const Capabilities& capabilities);
+
+    // Selects the colors the output may use (native backend). Initscr takes
+    // the color depth the terminal announces, unless one was selected before.
+    // Colors beyond the depth are shown as the nearest color available.
+    void SetColorDepth(ColorDepth color_depth);
+    ColorDepth GetColorDepth() const { return color_depth_; }
+
+    // Returns the counters of the output written by Refresh. The output
+    // counters stay zero with the ncurses backend.
+    const FrameStats& GetFrameStats() const { return frame_stats_; }
+
+    // Returns the output of the last frame drawn by Refresh as read-only
+    // segments, for applications that pass the output on themselves (e.g.
+    // with the headless backend). The segments stay valid until the next
+    // Refresh or color change. Empty with the ncurses backend and with
+    // asynchronous rendering.
+    const std::vector<FrameSegment>& GetFrameSegments() const;
+
     bool HasColor();
 
     // Initializes color support.
@@ -140,6 +217,11 @@ class Wcurses {
     // Resets the active color pair to default.
     void Attroff();
 
+    // Turns text attributes (e.g. Attr::kBold | Attr::kUnderline) on or off
+    // for the characters written next.
+    void Attron(Attr attributes);
+    void Attroff(Attr attributes);
+
     // Pauses execution for a given number of milliseconds.
     void Sleep(unsigned milliseconds);
 
@@ -160,23 +242,116 @@ class Wcurses {
     // Returns the current cursor position.
     Point Getyx() const;
 
+    // Enables or disables scrolling: when enabled, a new line on the bottom
+    // line of the scrolling region scrolls the region up.
+    void ScrollOk(bool enable);
+
+    // Sets the scrolling region to the rows [top, bottom].
+    void SetScrollRegion(short top, short bottom);
+
+    // Scrolls the scrolling region up by the given number of lines
+    // (down if negative). Requires scrolling to be enabled.
+    void Scroll(short lines);
+
     // Clears the screen.
     void ClearScreen();
 
+    // The rectangle functions below work on whole row spans, are clipped to
+    // the screen and leave the cursor where it is.
+
+    // Fills rect with a character in the current attributes and color pair.
+    void FillRect(const Rect& rect, char32_t symbol = U' ');
+
+    // Blanks rect.
+    void ClearRect(const Rect& rect);
+
+    // Changes the attributes and the color pair of rect, keeping its text
+    // (like chgat), e.g. to highlight a selected row.
+    void ChangeAttrRect(const Rect& rect, Attr attributes, short pair_index);
+
+    // Draws a line of length cells from (y, x) to the right or downwards, by
+    // default with the box drawing characters U+2500 and U+2502.
+    void HLine(short y, short x, short length, char32_t symbol = 0x2500);
+    void VLine(short y, short x, short length, char32_t symbol = 0x2502);
+
+    // Copies the part of pad whose upper left corner is origin into rect of
+    // the screen, like prefresh without the refresh: a scrolled view of a
+    // large pad only copies the rows and columns that are visible. Only the
+    // cells that differ from the screen are drawn by the next Refresh.
+    void DrawPad(const Pad& pad, const PointL& origin, const Rect& rect);
+
+    // Creates a window onto rect of the screen, with its own cursor and
+    // style (see Window). With the ncurses backend, or before Initscr, the
+    // window is not attached to the screen and does nothing.
+    Window NewWindow(const Rect& rect);
+
+    // Creates a layer of the size of rect at its position, above the screen
+    // and the other layers (see Layer). Returns nullptr with the ncurses
+    // backend or before Initscr.
+    Layer* NewLayer(const Rect& rect);
+
+    // Deletes a layer; the screen below it shows again with the next Refresh.
+    void DeleteLayer(Layer* layer);
+
+    // Takes a snapshot of the screen (see Snapshot). Layers are not part of
+    // it. Returns an empty snapshot with the ncurses backend or before Initscr.
+    Snapshot TakeSnapshot();
+
+    // Puts the cells of snapshot back on the screen, in the area shared with
+    // the current size; only the cells that differ are drawn by the next
+    // Refresh. The cursor does not move.
+    void RestoreSnapshot(const Snapshot& snapshot);
+
     // Sets cursor visibility
     void SetCursorVisibility(int visibility);
 
   private:
-#ifdef _WIN32
+    using Clock = std::chrono::steady_clock;
+
     internal::Terminal* terminal_ = nullptr;
     internal::Buffer* buffer_ = nullptr;
     internal::InputManager* input_manager_ = nullptr;
+    internal::RenderThread* render_thread_ = nullptr; // Only in asynchronous mode.
+
+    bool was_initialized_ = false;
+
+    FrameStats frame_stats_;
+    Capabilities capabilities_;
+    ColorDepth color_depth_ = ColorDepth::kTrueColor;
+    bool is_color_depth_selected_ = false; // Selected by the application, not detected.
 
+    Clock::duration frame_interval_ = Clock::duration::zero(); // Zero without a frame rate.
+    Clock::time_point last_frame_time_;
+    bool is_frame_pending_ = false; // Refreshed, but not drawn yet.
+    bool is_frame_dropped_ = false; // The pending frame was skipped for a congested terminal.
+    bool no_delay_ = false;
+
+    // Draws the pending frame if the frame interval has passed.
+    void FlushIfDue();
+
+    // Takes the output counters over from the render thread.
+    void UpdateFrameStats();
+
+    // Continues writing the frame output the terminal did not take yet,
+    // without waiting. Returns true if nothing is left.
+    bool SendPendingOutput();
+
+    // Blocks until the terminal has taken every frame, including a pending one.
+    void DrainOutput();
+
+#ifdef _WIN32
     std::streambuf* original_cout_buffer_ = nullptr;
     std::streambuf* original_cin_buffer_ = nullptr;
     std::stringstream dummy_stream_;
+#else
+    Backend backend_ = Backend::kNcurses;
 
-    bool was_initialized_ = false;
+    int float_precision_ = 6;
+    FloatFormat float_format_ = FloatFormat::kFixed;
+
+    // Adopts the size of the terminal if it changed since the previous call.
+    // Returns true if the size changed.
+    bool UpdateSize();
 #endif
 
   // Private constructor to enforce singleton pattern.
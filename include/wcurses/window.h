@@ -0,0 +1,124 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WCURSES_WINDOW_H_
+#define WCURSES_WINDOW_H_
+
+#include <cstddef>
+#include <string>
+
+#include "buffer.h"
+#include "pad.h"
+#include "point.h"
+#include "structures.h"
+
+namespace curs {
+
+// The Window class is a view onto a rectangle of the screen with its own
+// cursor, color pair and attributes. It has no cells of its own: text is
+// written straight into the screen, clipped to the window, and drawn by the
+// next Wcurses::Refresh like any other change. Creating, moving or resizing
+// a window copies nothing, so a dashboard can keep a window per panel.
+//
+// Positions are relative to the upper left corner of the window. A window
+// that reaches past the screen, e.g. after the terminal became smaller, is
+// clipped to it. Windows do not scroll: text past the bottom row stays on it.
+//
+// Windows are created with Wcurses::NewWindow and refer to the screen of
+// the native backend; they must not be used after Endwin. The window of a
+// Layer writes into the cells of the layer instead (see Layer::GetWindow).
+class Window {
+  public:
+    // Creates a window that is not attached to a screen. Its operations do nothing.
+    Window() = default;
+
+    // Output stream operators, see the ones of Wcurses.
+    Window& operator<<(char ch);
+    Window& operator<<(const char* str);
+    Window& operator<<(const std::string& str);
+    Window& operator<<(int val);
+    Window& operator<<(long val);
+    Window& operator<<(long long val);
+    Window& operator<<(unsigned val);
+    Window& operator<<(unsigned long val);
+    Window& operator<<(unsigned long long val);
+    Window& operator<<(double val);
+
+    // Outputs length characters starting at str.
+    Window& Write(const char* str, std::size_t length);
+
+    // Moves the cursor of the window.
+    void MoveTo(short y, short x);
+    Point Getyx() const;
+
+    // Sets the color pair of the characters written next. An undefined pair
+    // is ignored, like Wcurses::Attron.
+    void Attron(short pair_index);
+
+    // Resets the color pair to the default one.
+    void Attroff();
+
+    // Turns text attributes on or off for the characters written next.
+    void Attron(Attr attributes);
+    void Attroff(Attr attributes);
+
+    // Blanks the window and moves its cursor to the upper left corner.
+    void Clear();
+
+    // Rectangle operations within the window, see the ones of Wcurses.
+    void FillRect(const Rect& rect, char32_t symbol = U' ');
+    void ClearRect(const Rect& rect);
+    void ChangeAttrRect(const Rect& rect, Attr attributes, short pair_index);
+    void HLine(short y, short x, short length, char32_t symbol = 0x2500);
+    void VLine(short y, short x, short length, char32_t symbol = 0x2502);
+
+    // Copies the part of pad whose upper left corner is origin into rect of
+    // the window, see Wcurses::DrawPad.
+    void DrawPad(const Pad& pad, const PointL& origin, const Rect& rect);
+
+    // Moves the window to another position on the screen. The cells it
+    // leaves keep their contents.
+    void MoveWindow(short y, short x);
+
+    // Changes the size of the window. The cursor is kept inside.
+    void Resize(short rows, short cols);
+
+    // Returns the rectangle the window covers on the screen.
+    const Rect& GetRect() const { return view_.rect; }
+
+    // Returns false for a window that is not attached to a screen.
+    bool IsValid() const { return buffer_ != nullptr; }
+
+  private:
+    friend class Layer;
+    friend class Wcurses;
+
+    internal::Buffer* buffer_ = nullptr;
+    internal::TextView view_;
+
+    Window(internal::Buffer* buffer, const Rect& rect, internal::CellGrid* grid = nullptr);
+
+    // Limits the rectangle to the cells written to, the screen or a layer:
+    // the window keeps at least one cell.
+    void SetRect(Rect rect);
+
+    // Formats a number on the stack and writes it.
+    template <typename T>
+    Window& WriteInteger(T val);
+};
+
+} // namespace curs
+
+#endif // WCURSES_WINDOW_H_
@@ -17,12 +17,18 @@
 
 #include <cstring>
 
+#include <algorithm>
 #include <string>
-#include <vector>
 
+#include "wcurses/cell_grid.h"
 #include "wcurses/color_manager.h"
+#include "wcurses/compositor.h"
 #include "wcurses/cursor.h"
+#include "wcurses/number_format.h"
+#include "wcurses/pad.h"
 #include "wcurses/point.h"
+#include "wcurses/renderer.h"
+#include "wcurses/unicode.h"
 
 curs::internal::Buffer::Buffer(Size size) {
   Initialize(size);
@@ -33,205 +39,667 @@ curs::internal::Buffer::Buffer(short rows, short cols) {
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(char ch) {
+  Put(view_, ch);
+  return *this;
+}
+
+curs::internal::Buffer& curs::internal::Buffer::operator<<(const char* str) {
+  return Write(str, std::strlen(str));
+}
+
+curs::internal::Buffer& curs::internal::Buffer::operator<<(const std::string& str) {
+  return Write(str.data(), str.size());
+}
+
+curs::internal::Buffer& curs::internal::Buffer::Write(const char* str, size_t length) {
+  Write(view_, str, length);
+  return *this;
+}
+
+void curs::internal::Buffer::Put(TextView& view, char ch) {
+  if (!FitView(view)) {
+    return;
+  }
+
+  // The bytes of a UTF-8 sequence are collected until the character is complete.
+  if (view.utf8_pending_length > 0 || static_cast<unsigned char>(ch) >= 0x80) {
+    view.utf8_pending[view.utf8_pending_length++] = ch;
+    PutPendingUtf8(view);
+    return;
+  }
+
+  const short cols = view.cursor.GetWidthLimit();
+
   // Move cursor to the next line if it reaches or exceeds the rightmost column.
-  if (cursor_.GetX() >= size_.cols) {
-    NewLine();
+  if (view.cursor.GetX() >= cols) {
+    NewLine(view);
   }
 
   // Handle newline character explicitly.
   if (ch == '\n') {
-    NewLine();
-    return *this;
+    NewLine(view);
+    return;
   }
 
-  if(color_manager_.IsStartedColor()) {
-    // Saving a character with a color if color mode is supported
-    buffer_[cursor_.GetY()][cursor_.GetX()].symbol = ch;
-    buffer_[cursor_.GetY()][cursor_.GetX()].color_pair = color_manager_.GetActivePair();
-  } else {
-    // Saving only a character
-    buffer_char_[cursor_.GetY()][cursor_.GetX()] = ch;
-  }
+  const short y = view.rect.y + view.cursor.GetY();
+  const short x = view.rect.x + view.cursor.GetX();
+  CellGrid& grid = Target(view);
+
+  BreakWideCharacters(grid, y, x, x + 1);
+
+  // Without color support the active pair is always the default one,
+  // so the same cell layout serves both modes.
+  grid.At(y, x) = {static_cast<unsigned char>(ch), view.attributes, view.pair};
+  grid.MarkDirty(y, x, x + 1);
 
   // If the cursor reaches the last column, go to a new line
-  if (cursor_.GetX() >= size_.cols - 1) {
-    NewLine();
+  if (view.cursor.GetX() >= cols - 1) {
+    NewLine(view);
   } else {
-    cursor_.MoveRight();
+    view.cursor.MoveRight();
   }
-
-  return *this;
 }
 
-curs::internal::Buffer& curs::internal::Buffer::operator<<(const char* str) {
-  size_t length = std::strlen(str); // Get the length of the C-string
+void curs::internal::Buffer::Write(TextView& view, const char* str, size_t length) {
+  const char* end = str + length;
 
-  for (int i = 0; i < length; ++i) {
-    *this << str[i]; // Use an overloaded operator for the symbol
+  // Complete a character that the previous write ended in the middle of.
+  while (view.utf8_pending_length > 0 && str < end) {
+    Put(view, *str++);
+  }
+
+  if (!FitView(view)) {
+    return;
+  }
+
+  const short cols = view.cursor.GetWidthLimit();
+  CellGrid& grid = Target(view);
+
+  while (str < end) {
+    // Handle newline character explicitly.
+    if (*str == '\n') {
+      NewLine(view);
+      ++str;
+      continue;
+    }
+
+    // The text up to the next newline is written row segment by row segment.
+    const char* line_end = static_cast<const char*>(std::memchr(str, '\n', end - str));
+    if (line_end == nullptr) {
+      line_end = end;
+    }
+
+    while (str < line_end) {
+      const short y = view.rect.y + view.cursor.GetY();
+      const short x = view.rect.x + view.cursor.GetX();
+
+      // Copy as much of the line as fits into the rest of the row, up to
+      // the first character that is not ASCII.
+      size_t count = std::min<size_t>(line_end - str, cols - view.cursor.GetX());
+      size_t ascii_count = 0;
+
+      while (ascii_count < count && static_cast<unsigned char>(str[ascii_count]) < 0x80) {
+        ++ascii_count;
+      }
+
+      if (ascii_count == 0) {
+        char32_t code_point;
+        size_t sequence_length = DecodeUtf8(str, end - str, &code_point);
+
+        // The rest of the character comes with the next write.
+        if (sequence_length == 0) {
+          std::memcpy(view.utf8_pending, str, end - str);
+          view.utf8_pending_length = end - str;
+          str = end;
+          break;
+        }
+
+        PutCodePoint(view, code_point);
+        str += sequence_length;
+        continue;
+      }
+
+      count = ascii_count;
+      BreakWideCharacters(grid, y, x, static_cast<short>(x + count));
+
+      ChType* cell = grid.Row(y) + x;
+
+      for (size_t i = 0; i < count; ++i) {
+        cell[i].symbol = static_cast<unsigned char>(str[i]);
+        cell[i].attributes = view.attributes;
+        cell[i].color_pair = view.pair;
+      }
+
+      grid.MarkDirty(y, x, static_cast<short>(x + count));
+      str += count;
+
+      // If the cursor reaches the last column, go to a new line
+      if (view.cursor.GetX() + count >= static_cast<size_t>(cols)) {
+        view.cursor.SetX(cols - 1);
+        NewLine(view);
+      } else {
+        view.cursor.SetX(static_cast<short>(view.cursor.GetX() + count));
+      }
+    }
   }
- 
-  return *this;
 }
 
-curs::internal::Buffer& curs::internal::Buffer::operator<<(const std::string& str) {
-  for (size_t i = 0; i < str.size(); ++i) {
-  *this << str[i];
+template <typename T>
+curs::internal::Buffer& curs::internal::Buffer::WriteInteger(T val) {
+  char digits[kMaxIntegerLength];
+  char* digits_end = digits + kMaxIntegerLength;
+  char* first = FormatInteger(val, digits_end);
+
+  return Write(first, digits_end - first);
+}
+
+template <typename T>
+curs::internal::Buffer& curs::internal::Buffer::WriteFloat(T val) {
+  char digits[kFloatBufferSize];
+  size_t length = FormatFloat(val, float_precision_, float_format_, digits, sizeof(digits));
+
+  if (length < sizeof(digits)) {
+    return Write(digits, length);
   }
 
-  return *this;
+  // Only huge values in fixed notation do not fit on the stack.
+  std::string long_digits(length + 1, '\0');
+  FormatFloat(val, float_precision_, float_format_, &long_digits[0], long_digits.size());
+
+  return Write(long_digits.data(), length);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(short val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteInteger(val);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(unsigned short val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteInteger(val);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(int val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteInteger(val);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(unsigned int val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteInteger(val);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(long val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteInteger(val);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(unsigned long val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteInteger(val);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(long long val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteInteger(val);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(unsigned long long val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteInteger(val);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(float val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteFloat(val);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(double val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteFloat(val);
 }
 
 curs::internal::Buffer& curs::internal::Buffer::operator<<(long double val) {
-  *this << std::to_string(val);
-
-  return *this;
+  return WriteFloat(val);
 }
 
 void curs::internal::Buffer::Resize(Size new_size) {
-  Initialize(new_size);
+  if(new_size.rows < kMinSize || new_size.cols < kMinSize) {
+      new_size.rows = kMinSize;
+      new_size.cols = kMinSize;
+  }
+
+  // Keep the cursor as close to its position as the new size allows.
+  Point cursor_position = view_.cursor.GetPosition();
+  cursor_position.y = std::min<short>(cursor_position.y, new_size.rows - 1);
+  cursor_position.x = std::min<short>(cursor_position.x, new_size.cols - 1);
+
+  // A wide character that loses its right half is replaced by a blank.
+  if (new_size.cols < size_.cols) {
+    const short rows = std::min(new_size.rows, size_.rows);
+
+    for (short y = 0; y < rows; ++y) {
+      if (grid_.At(y, new_size.cols).symbol == kWideContinuation) {
+        grid_.At(y, new_size.cols - 1).symbol = U' ';
+        grid_.MarkDirty(y, new_size.cols - 1, new_size.cols);
+      }
+    }
+  }
+
+  size_ = new_size;
+
+  // The contents of the overlapping area are kept, and only the newly
+  // exposed cells are blanked and marked as damaged.
+  grid_.Resize(size_);
+
+  view_.rect = {0, 0, size_.rows, size_.cols};
+  view_.cursor.SetLimit(size_.rows, size_.cols);
+  view_.cursor.Move(cursor_position);
+
+  // The scrolling region covers the whole buffer again.
+  scroll_top_ = 0;
+  scroll_bottom_ = size_.rows - 1;
 }
 
 void curs::internal::Buffer::Resize(short new_rows, short new_cols) {
-  Initialize({new_rows, new_cols});
+  Resize({new_rows, new_cols});
+}
+
+void curs::internal::Buffer::RefreshScreenBuffer(bool cursor_visible) {
+  renderer_.Render(ComposeFrame(), color_manager_, view_.cursor.GetPosition(), cursor_visible);
+
+  // Everything written so far is now part of the screen buffer.
+  ClearDamage();
+}
+
+void curs::internal::Buffer::ClearDamage() {
+  grid_.ClearDamage();
+  compositor_.ClearDamage();
+}
+
+void curs::internal::Buffer::Clear() {
+  grid_.Fill({' ', Attr::kNormal, ColorManager::GetDefaultPair()});
+  grid_.MarkAllDirty();
+
+  view_.cursor.Reset();
+}
+
+void curs::internal::Buffer::FillRect(const Rect& rect, char32_t symbol) {
+  FillRect(view_, rect, symbol);
+}
+
+void curs::internal::Buffer::ClearRect(const Rect& rect) {
+  ClearRect(view_, rect);
+}
+
+void curs::internal::Buffer::ChangeAttrRect(const Rect& rect, Attr attributes,
+                                            ColorManager::PairIndex pair_index) {
+  ChangeAttrRect(view_, rect, attributes, pair_index);
+}
+
+void curs::internal::Buffer::FillRect(TextView& view, const Rect& rect, char32_t symbol) {
+  Rect clipped = rect;
+
+  if (!ClipRect(view, &clipped)) {
+    return;
+  }
+
+  const int width = GetCharWidth(symbol);
+
+  // A combining character has nothing to join in an empty cell.
+  if (width == 0) {
+    symbol = U' ';
+  }
+
+  const short end = clipped.x + clipped.cols;
+  CellGrid& grid = Target(view);
+  const ChType cell {symbol, view.attributes, view.pair};
+
+  for (short y = clipped.y; y < clipped.y + clipped.rows; ++y) {
+    BreakWideCharacters(grid, y, clipped.x, end);
+
+    if (width != 2) {
+      grid.FillSpan(y, clipped.x, end, cell);
+      continue;
+    }
+
+    ChType* row = grid.Row(y);
+    short x = clipped.x;
+
+    for (; x + 1 < end; x += 2) {
+      row[x] = cell;
+      row[x + 1] = {kWideContinuation, view.attributes, view.pair};
+    }
+
+    if (x < end) {
+      row[x] = {U' ', view.attributes, view.pair};
+    }
+
+    grid.MarkDirty(y, clipped.x, end);
+  }
+}
+
+void curs::internal::Buffer::ClearRect(TextView& view, const Rect& rect) {
+  Rect clipped = rect;
+
+  if (!ClipRect(view, &clipped)) {
+    return;
+  }
+
+  const short end = clipped.x + clipped.cols;
+  CellGrid& grid = Target(view);
+
+  for (short y = clipped.y; y < clipped.y + clipped.rows; ++y) {
+    BreakWideCharacters(grid, y, clipped.x, end);
+    grid.FillSpan(y, clipped.x, end, {U' ', Attr::kNormal, ColorManager::GetDefaultPair()});
+  }
 }
 
-void curs::internal::Buffer::RefreshScreenBuffer() {
-  ColorManager::PairIndex current_pair = 0;
-  bool is_color_active = color_manager_.IsStartedColor();
+void curs::internal::Buffer::ChangeAttrRect(TextView& view, const Rect& rect, Attr attributes,
+                                            ColorManager::PairIndex pair_index) {
+  Rect clipped = rect;
 
-  if(is_color_active) {
-    // Save the initial color pair to track changes
-    current_pair = buffer_[0][0].color_pair;
-    // Get the ESC code to set the initial text and background color
-    screen_buffer_ = color_manager_.MakeColorCode(current_pair);
+  if (!ClipRect(view, &clipped)) {
+    return;
   }
 
-  for(int i = 0; i < size_.rows; ++i) {
-    for (int j = 0; j < size_.cols; ++j) {
-      if(is_color_active) {
-        ColorManager::PairIndex new_pair = buffer_[i][j].color_pair;
+  CellGrid& grid = Target(view);
+
+  if (!color_manager_.IsPairUsable(pair_index)) {
+    pair_index = ColorManager::GetDefaultPair();
+  }
+
+  for (short y = clipped.y; y < clipped.y + clipped.rows; ++y) {
+    ChType* row = grid.Row(y);
+    short begin = clipped.x;
+    short end = clipped.x + clipped.cols;
+
+    // Both halves of a wide character change together.
+    if (begin > 0 && row[begin].symbol == kWideContinuation) {
+      --begin;
+    }
+
+    if (end < grid.GetCols() && row[end].symbol == kWideContinuation) {
+      ++end;
+    }
+
+    for (short x = begin; x < end; ++x) {
+      row[x].attributes = attributes;
+      row[x].color_pair = pair_index;
+    }
 
-        if(new_pair != current_pair) {
-          // Generate ESC code only for changed parameters
-          screen_buffer_ += color_manager_.MakeColorCode(current_pair, new_pair);
-    
-          // Update the current color pair 
-          current_pair = new_pair;
+    grid.MarkDirty(y, begin, end);
+  }
+}
+
+void curs::internal::Buffer::DrawPad(TextView& view, const Pad& pad, const PointL& origin,
+                                     const Rect& rect) {
+  Rect clipped = rect;
+
+  if (!ClipRect(view, &clipped)) {
+    return;
+  }
+
+  CellGrid& grid = Target(view);
+  GraphemeTable& graphemes = grid_.GetGraphemes();
+  const ChType blank {U' ', Attr::kNormal, ColorManager::GetDefaultPair()};
+  const short end = clipped.x + clipped.cols;
+
+  // Pad position of the upper left corner of the clipped rectangle.
+  const long first_y = origin.y + (clipped.y - view.rect.y - rect.y);
+  const long first_x = origin.x + (clipped.x - view.rect.x - rect.x);
+
+  for (short y = clipped.y; y < clipped.y + clipped.rows; ++y) {
+    const long pad_y = first_y + (y - clipped.y);
+    ChType* row = grid.Row(y);
+    short changed_begin = end;
+    short changed_end = clipped.x;
+
+    BreakWideCharacters(grid, y, clipped.x, end);
+
+    // The row is copied chunk by chunk; cells that were never written are blank.
+    for (short x = clipped.x; x < end;) {
+      long count;
+      const ChType* cells = pad.FindCells(pad_y, first_x + (x - clipped.x), &count);
+      const short segment_end = static_cast<short>(x + std::min<long>(end - x, count));
+
+      for (; x < segment_end; ++x, cells += cells != nullptr ? 1 : 0) {
+        ChType cell = cells != nullptr ? *cells : blank;
+
+        if (cell.symbol >= kFirstGrapheme) {
+          cell.symbol = graphemes.Intern(pad.graphemes_.GetText(cell.symbol));
         }
 
-        screen_buffer_ += buffer_[i][j].symbol;
-      } else {
-        screen_buffer_ += buffer_char_[i][j];
+        if (!color_manager_.IsPairUsable(cell.color_pair)) {
+          cell.color_pair = ColorManager::GetDefaultPair();
+        }
+
+        // Only the cells that differ are marked, so an unchanged viewport
+        // costs the next frame nothing.
+        if (row[x] != cell) {
+          row[x] = cell;
+          changed_begin = std::min(changed_begin, x);
+          changed_end = static_cast<short>(x + 1);
+        }
       }
     }
-    // Add a newline character after each line except the last one
-    if (i < size_.rows - 1) {
-      screen_buffer_ += '\n';
+
+    // Wide characters cut by the edges of the viewport become blanks.
+    if (row[clipped.x].symbol == kWideContinuation) {
+      row[clipped.x].symbol = U' ';
+      changed_begin = std::min(changed_begin, clipped.x);
+      changed_end = std::max<short>(changed_end, clipped.x + 1);
+    }
+
+    if (pad.GetCell(pad_y, first_x + clipped.cols).symbol == kWideContinuation &&
+        row[end - 1].symbol != U' ') {
+      row[end - 1].symbol = U' ';
+      changed_begin = std::min<short>(changed_begin, end - 1);
+      changed_end = end;
+    }
+
+    if (changed_begin < changed_end) {
+      grid.MarkDirty(y, changed_begin, changed_end);
     }
   }
 }
 
-void curs::internal::Buffer::Clear() {
-  if(!buffer_.empty()) {
-    for(auto& rows : buffer_) {
-      for(auto& ch : rows) {
-        ch = {' ', ColorManager::GetDefaultPair()};
-      }
+bool curs::internal::Buffer::ClipRect(TextView& view, Rect* rect) const {
+  if (!FitView(view)) {
+    return false;
+  }
+
+  const int top = std::max<int>(rect->y, 0);
+  const int left = std::max<int>(rect->x, 0);
+  const int bottom = std::min<int>(rect->y + rect->rows, view.cursor.GetHeightLimit());
+  const int right = std::min<int>(rect->x + rect->cols, view.cursor.GetWidthLimit());
+
+  if (top >= bottom || left >= right) {
+    return false;
+  }
+
+  *rect = {static_cast<short>(view.rect.y + top), static_cast<short>(view.rect.x + left),
+           static_cast<short>(bottom - top), static_cast<short>(right - left)};
+  return true;
+}
+
+bool curs::internal::Buffer::FitView(TextView& view) const {
+  const Size& size = view.grid != nullptr ? view.grid->GetSize() : size_;
+  const short rows = std::min<short>(view.rect.rows, size.rows - view.rect.y);
+  const short cols = std::min<short>(view.rect.cols, size.cols - view.rect.x);
+
+  if (rows <= 0 || cols <= 0) {
+    return false;
+  }
+
+  if (view.cursor.GetHeightLimit() != rows || view.cursor.GetWidthLimit() != cols) {
+    view.cursor.SetLimit(rows, cols);
+  }
+
+  return true;
+}
+
+void curs::internal::Buffer::PutPendingUtf8(TextView& view) {
+  char32_t code_point;
+  size_t sequence_length = DecodeUtf8(view.utf8_pending, view.utf8_pending_length, &code_point);
+
+  if (sequence_length == 0) {
+    return;
+  }
+
+  // After an invalid byte the remaining bytes start over.
+  char rest[kMaxUtf8Length];
+  size_t rest_length = view.utf8_pending_length - sequence_length;
+  std::memcpy(rest, view.utf8_pending + sequence_length, rest_length);
+  view.utf8_pending_length = 0;
+
+  PutCodePoint(view, code_point);
+
+  for (size_t i = 0; i < rest_length; ++i) {
+    Put(view, rest[i]);
+  }
+}
+
+void curs::internal::Buffer::PutCodePoint(TextView& view, char32_t code_point) {
+  const int width = GetCharWidth(code_point);
+  CellGrid& grid = Target(view);
+  short previous_y;
+  short previous_x;
+
+  // Combining characters, the characters after a zero width joiner and the
+  // second half of a flag are part of the character before them.
+  if (FindPreviousCell(view, &previous_y, &previous_x)) {
+    ChType& previous = grid.At(previous_y, previous_x);
+
+    if (width == 0 || JoinsPrevious(grid_.GetGraphemes(), previous.symbol, code_point)) {
+      previous.symbol = grid_.GetGraphemes().Append(previous.symbol, code_point);
+      grid.MarkDirty(previous_y, previous_x, previous_x + 1);
+      return;
     }
   }
 
-  if(!buffer_char_.empty()) {
-    for(auto& rows : buffer_char_) {
-      for(auto& ch : rows) {
-        ch = ' ';
-      }
+  if (width == 0) {
+    return;
+  }
+
+  const short cols = view.cursor.GetWidthLimit();
+
+  if (view.cursor.GetX() >= cols) {
+    NewLine(view);
+  }
+
+  // A wide character that does not fit into the last column goes to the
+  // next row, unless the cursor stays on the bottom row.
+  if (width == 2 && view.cursor.GetX() == cols - 1) {
+    Put(view, ' ');
+
+    if (view.cursor.GetX() == cols - 1) {
+      return;
     }
   }
 
-  cursor_.Reset();
+  const short y = view.rect.y + view.cursor.GetY();
+  const short x = view.rect.x + view.cursor.GetX();
+
+  BreakWideCharacters(grid, y, x, static_cast<short>(x + width));
+
+  ChType* cell = grid.Row(y) + x;
+  cell[0] = {code_point, view.attributes, view.pair};
+
+  if (width == 2) {
+    cell[1] = {kWideContinuation, view.attributes, view.pair};
+  }
+
+  grid.MarkDirty(y, x, static_cast<short>(x + width));
+
+  if (view.cursor.GetX() + width >= cols) {
+    view.cursor.SetX(cols - 1);
+    NewLine(view);
+  } else {
+    view.cursor.SetX(static_cast<short>(view.cursor.GetX() + width));
+  }
+}
+
+bool curs::internal::Buffer::FindPreviousCell(const TextView& view, short* y, short* x) const {
+  *y = view.cursor.GetY();
+  *x = static_cast<short>(view.cursor.GetX() - 1);
+
+  if (*x < 0) {
+    if (*y == 0) {
+      return false;
+    }
+
+    --*y;
+    *x = static_cast<short>(view.cursor.GetWidthLimit() - 1);
+  }
+
+  *y += view.rect.y;
+  *x += view.rect.x;
+
+  if (*x > view.rect.x && Target(view).At(*y, *x).symbol == kWideContinuation) {
+    --*x;
+  }
+
+  return true;
+}
+
+void curs::internal::Buffer::BreakWideCharacters(CellGrid& grid, short y, short begin, short end) {
+  ChType* row = grid.Row(y);
+
+  if (begin > 0 && row[begin].symbol == kWideContinuation) {
+    row[begin - 1].symbol = U' ';
+    grid.MarkDirty(y, begin - 1, begin);
+  }
+
+  if (end < grid.GetCols() && row[end].symbol == kWideContinuation) {
+    row[end].symbol = U' ';
+    grid.MarkDirty(y, end, end + 1);
+  }
 }
 
 void curs::internal::Buffer::NewLine() {
-	if (!cursor_.IsAtBottom()) {
-		cursor_.MoveDown();
-		cursor_.ResetX();
+  NewLine(view_);
+}
+
+void curs::internal::Buffer::NewLine(TextView& view) {
+  // At the bottom of the scrolling region the text moves up instead.
+  if (&view == &view_ && is_scrolling_enabled_ && view.cursor.GetY() == scroll_bottom_) {
+    Scroll(1);
+    view.cursor.ResetX();
+    return;
+  }
+
+	if (!view.cursor.IsAtBottom()) {
+		view.cursor.MoveDown();
+		view.cursor.ResetX();
 	}
 }
 
+bool curs::internal::Buffer::SetScrollRegion(short top, short bottom) {
+  if (top < 0 || bottom >= size_.rows || top > bottom) {
+    return false;
+  }
+
+  scroll_top_ = top;
+  scroll_bottom_ = bottom;
+
+  return true;
+}
+
+void curs::internal::Buffer::Scroll(short count) {
+  if (!is_scrolling_enabled_) {
+    return;
+  }
+
+  // Rows move in the grid without being copied, and the renderer
+  // repeats the scroll on the terminal.
+  grid_.Scroll(scroll_top_, scroll_bottom_, count, {' ', Attr::kNormal, ColorManager::GetDefaultPair()});
+}
+
 void curs::internal::Buffer::Move(short y, short x) {
-  cursor_.Move(y, x);
+  view_.cursor.Move(y, x);
 }
 
 void curs::internal::Buffer::Move(const Point& cursor_position) {
-  cursor_.Move(cursor_position);
+  view_.cursor.Move(cursor_position);
 }
 
 void curs::internal::Buffer::MoveBy(short delta_y, short delta_x) {
-  cursor_.MoveBy(delta_y, delta_x);
+  view_.cursor.MoveBy(delta_y, delta_x);
 }
 
 void curs::internal::Buffer::MoveBy(const Point& cursor_offset) {
-  cursor_.MoveBy(cursor_offset);
+  view_.cursor.MoveBy(cursor_offset);
 }
 
 void curs::internal::Buffer::StartColor() {
@@ -239,10 +707,8 @@ void curs::internal::Buffer::StartColor() {
     return;
   }
 
+  // Cells already carry the default pair, so nothing has to be converted.
   color_manager_.StartColor();
-
-  // Move all characters from buffer_char_ to buffer_ since buffer_ supports color rendering
-  MigrateBuffer(buffer_char_, buffer_);  
 }
 
 void curs::internal::Buffer::InitColor(
@@ -274,10 +740,12 @@ void curs::internal::Buffer::InitDefaultPair(ColorManager::PairIndex pair_index)
 
 void curs::internal::Buffer::SetActivePair(ColorManager::PairIndex pair_index) {
   color_manager_.SetActivePair(pair_index);
+  view_.pair = color_manager_.GetActivePair();
 }
 
 void curs::internal::Buffer::ResetToDefaultPair() {
   color_manager_.ResetToDefault();
+  view_.pair = color_manager_.GetActivePair();
 }
 
 void curs::internal::Buffer::Initialize(Size size) {
@@ -286,49 +754,13 @@ void curs::internal::Buffer::Initialize(Size size) {
       size.cols = kMinSize;
   }
 
-  screen_buffer_.clear();
-  screen_buffer_.shrink_to_fit();
-  
-  buffer_.clear();
-  buffer_.shrink_to_fit();
-
-  buffer_char_.clear();
-  buffer_char_.shrink_to_fit();
-
   size_ = size;
 
-  cursor_.SetLimit(size_.rows, size_.cols);
-
-  if(color_manager_.IsStartedColor()) {
-    InitializeBuffer(buffer_, size);
-  } else {
-    InitializeBuffer(buffer_char_, size);
-  }
-}
-
-void curs::internal::Buffer::InitializeBuffer(BufferType& buffer, Size size) {
-  buffer.resize(size.rows, std::vector<ChType>(size.cols)); 
-}
-
-void curs::internal::Buffer::InitializeBuffer(BufferCharType& buffer, Size size,
-                                              char fill_char) {
-    buffer.resize(size.rows, std::vector<char>(size.cols, fill_char));
-}
-
-void curs::internal::Buffer::MigrateBuffer(BufferCharType& source,
-                                           BufferType& destination) {
-  if(source.empty() || !destination.empty()) {
-    return;
-  }
-
-  InitializeBuffer(destination, size_);
+  view_.rect = {0, 0, size_.rows, size_.cols};
+  view_.cursor.SetLimit(size_.rows, size_.cols);
 
-  for (int i = 0; i < size_.rows; ++i) {
-    for (int j = 0; j < size_.cols; ++j) {
-      destination[i][j].symbol = source[i][j];
-    }
-  }
+  scroll_top_ = 0;
+  scroll_bottom_ = size_.rows - 1;
 
-  source.clear();
-  source.shrink_to_fit();
+  grid_.Resize(size);
 }
\ No newline at end of file
@@ -0,0 +1,446 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wcurses/cell_grid.h"
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+#include "wcurses/structures.h"
+#include "wcurses/unicode.h"
+
+// Rows are copied and filled as raw memory, so cells must stay plain data.
+static_assert(std::is_trivially_copyable<curs::internal::ChType>::value,
+              "ChType must be trivially copyable");
+static_assert(sizeof(curs::internal::ChType) == 8, "ChType must stay packed");
+
+constexpr std::size_t curs::internal::CellGrid::kCacheLineSize;
+constexpr std::size_t curs::internal::CellGrid::kCellsPerLine;
+constexpr curs::internal::DirtySpan curs::internal::CellGrid::kCleanSpan;
+
+curs::internal::GridSnapshot::Data::~Data() {
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  auto found = std::find(registry->snapshots.begin(), registry->snapshots.end(), this);
+
+  // A snapshot the grid let go of is no longer registered.
+  if (found != registry->snapshots.end()) {
+    registry->snapshots.erase(found);
+  }
+}
+
+void curs::internal::GridSnapshot::CopyRow(short y, ChType* out) const {
+  std::lock_guard<std::mutex> lock(data_->registry->mutex);
+  const ChType* row = FindRow(y);
+
+  std::copy(row, row + data_->size.cols, out);
+}
+
+std::string curs::internal::GridSnapshot::GetRowText(short y) const {
+  std::lock_guard<std::mutex> lock(data_->registry->mutex);
+  const ChType* row = FindRow(y);
+  std::string text;
+
+  text.reserve(data_->size.cols);
+
+  for (short x = 0; x < data_->size.cols; ++x) {
+    const char32_t symbol = row[x].symbol;
+
+    if (symbol == kWideContinuation) {
+      continue;
+    }
+
+    if (symbol >= kFirstGrapheme) {
+      text += data_->registry->graphemes.GetText(symbol);
+      continue;
+    }
+
+    char bytes[kMaxUtf8Length];
+    text.append(bytes, EncodeUtf8(symbol, bytes));
+  }
+
+  return text;
+}
+
+const curs::internal::ChType* curs::internal::GridSnapshot::FindRow(short y) const {
+  const short slot = data_->slots[y];
+
+  if (data_->copies[slot]) {
+    return data_->copies[slot].get();
+  }
+
+  const CellGrid& grid = *data_->registry->grid;
+  return grid.cells_ + slot * grid.stride_;
+}
+
+curs::internal::CellGrid::CellGrid(Size size) {
+  Resize(size);
+}
+
+curs::internal::CellGrid::~CellGrid() {
+  DetachSnapshots();
+}
+
+void curs::internal::CellGrid::Resize(Size size, const ChType& fill) {
+  const Size old_size = size_;
+
+  // The rows may move to new storage and change their slots.
+  DetachSnapshots();
+
+  // The ring depends on the number of rows, start it over from row 0.
+  Linearize();
+
+  if (static_cast<std::size_t>(size.cols) > stride_ || size.rows > row_capacity_) {
+    // Grow by at least half of the current capacity, so that a window being
+    // dragged bigger does not reallocate on every step.
+    std::size_t cols = std::max<std::size_t>(size.cols, stride_ + stride_ / 2);
+    int rows = std::max<int>(size.rows, row_capacity_ + row_capacity_ / 2);
+
+    // Round the row length up to whole cache lines so that every row
+    // starts on its own cache line.
+    std::size_t stride = (cols + kCellsPerLine - 1) / kCellsPerLine * kCellsPerLine;
+
+    Reallocate(stride, static_cast<short>(std::min<int>(rows, std::numeric_limits<short>::max())),
+               std::min(old_size.rows, size.rows), std::min(old_size.cols, size.cols));
+  }
+
+  size_ = size;
+
+  const short kept_rows = std::min(old_size.rows, size.rows);
+
+  // Rows that only moved by a scroll are not damaged; without the scroll
+  // to replay, they have to be repainted.
+  for (const ScrollOp& scroll : scrolls_) {
+    for (short y = scroll.top; y <= scroll.bottom && y < kept_rows; ++y) {
+      damage_[Slot(y)] = {0, old_size.cols};
+    }
+  }
+
+  scrolls_.clear();
+
+  // Damage outside of the new size no longer exists.
+  for (short y = 0; y < kept_rows; ++y) {
+    DirtySpan& span = damage_[Slot(y)];
+    span.end = std::min(span.end, size.cols);
+  }
+
+  // Blank the columns exposed on the right of the rows that were kept...
+  if (size.cols > old_size.cols) {
+    for (short y = 0; y < kept_rows; ++y) {
+      std::fill(Row(y) + old_size.cols, Row(y) + size.cols, fill);
+      MarkDirty(y, old_size.cols, size.cols);
+    }
+  }
+
+  // ...and the rows exposed at the bottom.
+  for (short y = kept_rows; y < size.rows; ++y) {
+    std::fill(Row(y), Row(y) + size.cols, fill);
+    damage_[Slot(y)] = {0, size.cols};
+    is_dirty_ = true;
+  }
+}
+
+void curs::internal::CellGrid::Reallocate(std::size_t stride, short row_capacity,
+                                          short rows, short cols) {
+  std::size_t cell_count = stride * row_capacity;
+  std::size_t bytes = cell_count * sizeof(ChType);
+  std::size_t space = bytes + kCacheLineSize;
+
+  // Over-allocate by one cache line and align the start of the array inside it.
+  std::unique_ptr<unsigned char[]> storage(new unsigned char[space]);
+  void* aligned = storage.get();
+  std::align(kCacheLineSize, bytes, aligned, space);
+
+  ChType* cells = static_cast<ChType*>(aligned);
+  std::uninitialized_fill_n(cells, cell_count, ChType());
+
+  std::vector<DirtySpan> damage(row_capacity, kCleanSpan);
+
+  // Keep the part of the old grid that is still visible. In the new storage
+  // every row is back in the slot with its own number.
+  for (short y = 0; y < rows; ++y) {
+    std::copy(Row(y), Row(y) + cols, cells + y * stride);
+    damage[y] = damage_[Slot(y)];
+  }
+
+  storage_ = std::move(storage);
+  cells_ = cells;
+  stride_ = stride;
+  row_capacity_ = row_capacity;
+  damage_ = std::move(damage);
+
+  row_slots_.resize(row_capacity);
+  for (short slot = 0; slot < row_capacity; ++slot) {
+    row_slots_[slot] = slot;
+  }
+
+  slot_generations_.assign(row_capacity, generation_);
+
+  first_row_ = 0;
+  slot_scratch_.reserve(row_capacity);
+}
+
+void curs::internal::CellGrid::Linearize() {
+  if (first_row_ == 0) {
+    return;
+  }
+
+  std::rotate(row_slots_.begin(), row_slots_.begin() + first_row_,
+              row_slots_.begin() + size_.rows);
+  first_row_ = 0;
+}
+
+void curs::internal::CellGrid::Fill(const ChType& cell) {
+  // Rows shared with a snapshot are copied into it first.
+  for (short y = 0; y < size_.rows; ++y) {
+    Row(y);
+  }
+
+  // The padding at the end of each row and the unused slots are filled
+  // as well: this keeps the whole grid a single linear pass.
+  std::fill_n(cells_, stride_ * row_capacity_, cell);
+}
+
+void curs::internal::CellGrid::MarkAllDirty() {
+  std::fill(damage_.begin(), damage_.end(), DirtySpan{0, size_.cols});
+  scrolls_.clear();
+  is_dirty_ = true;
+}
+
+void curs::internal::CellGrid::ClearDamage() {
+  std::fill(damage_.begin(), damage_.end(), kCleanSpan);
+  scrolls_.clear();
+  is_dirty_ = false;
+}
+
+void curs::internal::CellGrid::Scroll(short top, short bottom, short count,
+                                      const ChType& fill) {
+  top = std::max<short>(top, 0);
+  bottom = std::min<short>(bottom, size_.rows - 1);
+
+  if (top > bottom || count == 0) {
+    return;
+  }
+
+  const short height = bottom - top + 1;
+
+  // Scrolling by the height of the region or more replaces every row.
+  count = std::max<short>(-height, std::min(count, height));
+
+  if (top == 0 && bottom == size_.rows - 1) {
+    // The whole grid scrolls: move the start of the ring.
+    int first_row = (first_row_ + count + size_.rows) % size_.rows;
+    first_row_ = static_cast<short>(first_row);
+  } else {
+    // Rotate the slots of the region's rows.
+    const int shift = count > 0 ? count : count + height;
+
+    slot_scratch_.resize(height);
+    for (short i = 0; i < height; ++i) {
+      slot_scratch_[i] = Slot(top + i);
+    }
+
+    for (short i = 0; i < height; ++i) {
+      row_slots_[RingIndex(top + i)] = slot_scratch_[(i + shift) % height];
+    }
+  }
+
+  // Blank the rows that scrolled in.
+  short exposed_top = count > 0 ? bottom - count + 1 : top;
+  short exposed_bottom = count > 0 ? bottom : top - count - 1;
+
+  for (short y = exposed_top; y <= exposed_bottom; ++y) {
+    std::fill_n(Row(y), size_.cols, fill);
+    damage_[Slot(y)] = {0, size_.cols};
+  }
+
+  is_dirty_ = true;
+
+  // Consecutive scrolls of one region in one direction are merged.
+  if (!scrolls_.empty()) {
+    ScrollOp& last = scrolls_.back();
+
+    if (last.top == top && last.bottom == bottom && (last.count > 0) == (count > 0) &&
+        std::abs(last.count + count) <= height) {
+      last.count += count;
+      return;
+    }
+  }
+
+  scrolls_.push_back({top, bottom, count});
+}
+
+curs::internal::GridSnapshot curs::internal::CellGrid::TakeSnapshot() {
+  if (!snapshots_) {
+    snapshots_ = std::make_shared<GridSnapshot::Registry>();
+    snapshots_->grid = this;
+  }
+
+  // Every slot is shared from now on; only the slot table is copied.
+  std::shared_ptr<GridSnapshot::Data> data = std::make_shared<GridSnapshot::Data>();
+  data->registry = snapshots_;
+  data->generation = ++generation_;
+  data->size = size_;
+  data->slots.resize(size_.rows);
+  data->copies.resize(row_capacity_);
+
+  for (short y = 0; y < size_.rows; ++y) {
+    data->slots[y] = Slot(y);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(snapshots_->mutex);
+    snapshots_->snapshots.push_back(data.get());
+
+    // Usually nothing: entries are only added, and rarely.
+    if (snapshots_->graphemes.GetSize() != graphemes_.GetSize()) {
+      snapshots_->graphemes.CopyNewEntries(graphemes_);
+    }
+  }
+
+  GridSnapshot snapshot;
+  snapshot.data_ = std::move(data);
+  return snapshot;
+}
+
+void curs::internal::CellGrid::Restore(const GridSnapshot& snapshot) {
+  if (!snapshot.IsValid()) {
+    return;
+  }
+
+  const GridSnapshot::Data& data = *snapshot.data_;
+  const short rows = std::min(size_.rows, data.size.rows);
+  const short cols = std::min(size_.cols, data.size.cols);
+
+  for (short y = 0; y < rows; ++y) {
+    // A row still shared with the snapshot in its own place is unchanged.
+    if (!data.copies[data.slots[y]] && data.registry->grid == this && Slot(y) == data.slots[y]) {
+      continue;
+    }
+
+    const ChType* source = snapshot.FindRow(y);
+    ChType* row = Row(y);
+    short begin = 0;
+    short end = cols;
+
+    while (begin < end && row[begin] == source[begin]) {
+      ++begin;
+    }
+
+    while (end > begin && row[end - 1] == source[end - 1]) {
+      --end;
+    }
+
+    if (begin == end) {
+      continue;
+    }
+
+    std::copy(source + begin, source + end, row + begin);
+
+    // Wide characters cut in half by a change of size become blanks.
+    if (end == cols && cols < data.size.cols && source[cols].symbol == kWideContinuation) {
+      row[cols - 1].symbol = U' ';
+    }
+
+    if (end == cols && cols < size_.cols && row[cols].symbol == kWideContinuation) {
+      row[cols].symbol = U' ';
+      ++end;
+    }
+
+    MarkDirty(y, begin, end);
+  }
+}
+
+void curs::internal::CellGrid::PreserveSlot(short slot) {
+  if (snapshots_) {
+    std::lock_guard<std::mutex> lock(snapshots_->mutex);
+    std::shared_ptr<const ChType> copy;
+
+    // The snapshots taken since the slot was last copied share its cells.
+    for (auto it = snapshots_->snapshots.rbegin();
+         it != snapshots_->snapshots.rend() && (*it)->generation > slot_generations_[slot]; ++it) {
+      if (!copy) {
+        ChType* cells = new ChType[size_.cols];
+        std::copy(cells_ + slot * stride_, cells_ + slot * stride_ + size_.cols, cells);
+        copy.reset(cells, std::default_delete<ChType[]>());
+      }
+
+      (*it)->copies[slot] = copy;
+    }
+  }
+
+  slot_generations_[slot] = generation_;
+}
+
+void curs::internal::CellGrid::DetachSnapshots() {
+  if (!snapshots_) {
+    return;
+  }
+
+  // Rows still shared are copied into the snapshots.
+  for (short y = 0; y < size_.rows; ++y) {
+    Row(y);
+  }
+
+  // The registry lives on with the snapshots, if any are left.
+  std::shared_ptr<GridSnapshot::Registry> registry = std::move(snapshots_);
+  std::lock_guard<std::mutex> lock(registry->mutex);
+
+  registry->snapshots.clear();
+  registry->grid = nullptr;
+}
+
+void curs::internal::CellGrid::CopyChanges(const CellGrid& source) {
+  // The copied cells may use the characters interned since the last copy.
+  if (graphemes_.GetSize() != source.graphemes_.GetSize()) {
+    graphemes_.CopyNewEntries(source.graphemes_);
+  }
+
+  if (size_.rows != source.size_.rows || size_.cols != source.size_.cols) {
+    Resize(source.size_);
+
+    for (short y = 0; y < size_.rows; ++y) {
+      std::copy(source.Row(y), source.Row(y) + size_.cols, Row(y));
+    }
+
+    MarkAllDirty();
+    return;
+  }
+
+  // The rows scrolled in are damaged in source, so they are copied below.
+  for (const ScrollOp& scroll : source.scrolls_) {
+    Scroll(scroll.top, scroll.bottom, scroll.count);
+  }
+
+  if (!source.is_dirty_) {
+    return;
+  }
+
+  for (short y = 0; y < size_.rows; ++y) {
+    const DirtySpan& span = source.GetDirtySpan(y);
+
+    if (span.IsClean()) {
+      continue;
+    }
+
+    std::copy(source.Row(y) + span.begin, source.Row(y) + span.end, Row(y) + span.begin);
+    MarkDirty(y, span.begin, span.end);
+  }
+}
@@ -15,14 +15,129 @@
 
 #include "wcurses/color_manager.h"
 
-#include <unordered_map>
+#include <array>
 #include <string>
-#include <sstream>
+
+#include "wcurses/number_format.h"
 
 constexpr curs::internal::ColorManager::PairIndex curs::internal::ColorManager::kDefaultPair;
+constexpr int curs::internal::ColorManager::kMaxPairs;
+constexpr int curs::internal::ColorManager::kMaxColors;
+
+namespace {
+
+// Returned for pairs that produce no escape sequence.
+const std::string kEmptyCode;
+
+// Appends the decimal representation of a number to an escape sequence.
+void AppendNumber(std::string& color_code, int value) {
+  char digits[curs::internal::kMaxIntegerLength];
+  char* digits_end = digits + curs::internal::kMaxIntegerLength;
+  char* first = curs::internal::FormatInteger(value, digits_end);
+
+  color_code.append(first, digits_end - first);
+}
+
+// Colors of the 16 basic palette entries, as xterm shows them by default.
+const curs::RGB kBasicColors[16] = {
+  {0, 0, 0},       {205, 0, 0},     {0, 205, 0},     {205, 205, 0},
+  {0, 0, 238},     {205, 0, 205},   {0, 205, 205},   {229, 229, 229},
+  {127, 127, 127}, {255, 0, 0},     {0, 255, 0},     {255, 255, 0},
+  {92, 92, 255},   {255, 0, 255},   {0, 255, 255},   {255, 255, 255}
+};
+
+// Channel values of the 6x6x6 color cube of the 256-color palette (16-231).
+const short kCubeLevels[6] = {0, 95, 135, 175, 215, 255};
+
+// The grayscale ramp (232-255) starts at 8 and goes up in steps of 10.
+const int kFirstGray = 232;
+const int kGrayLevels = 24;
+
+int GetDistance(const curs::RGB& a, const curs::RGB& b) {
+  int red = a.red - b.red;
+  int green = a.green - b.green;
+  int blue = a.blue - b.blue;
+
+  return red * red + green * green + blue * blue;
+}
+
+// Returns the RGB value of an entry of the 256-color palette.
+curs::RGB GetPaletteColor(int index) {
+  if (index < 16) {
+    return kBasicColors[index];
+  }
+
+  if (index < kFirstGray) {
+    index -= 16;
+    return {kCubeLevels[index / 36], kCubeLevels[index / 6 % 6], kCubeLevels[index % 6]};
+  }
+
+  short gray = static_cast<short>(8 + (index - kFirstGray) * 10);
+  return {gray, gray, gray};
+}
+
+// Returns the basic color (0-15) closest to an RGB value.
+unsigned char FindNearest16(const curs::RGB& rgb) {
+  int nearest = 0;
+
+  for (int index = 1; index < 16; ++index) {
+    if (GetDistance(rgb, kBasicColors[index]) < GetDistance(rgb, kBasicColors[nearest])) {
+      nearest = index;
+    }
+  }
+
+  return static_cast<unsigned char>(nearest);
+}
+
+// Returns the index of the cube level closest to a channel value.
+int FindNearestLevel(short value) {
+  int nearest = 0;
+
+  while (nearest < 5 && value - kCubeLevels[nearest] > kCubeLevels[nearest + 1] - value) {
+    ++nearest;
+  }
+
+  return nearest;
+}
+
+// Returns the entry of the 256-color palette closest to an RGB value. Only the
+// color cube and the grayscale ramp are candidates: terminal themes often
+// change the basic colors.
+unsigned char FindNearest256(const curs::RGB& rgb) {
+  int cube = 16 + 36 * FindNearestLevel(rgb.red) + 6 * FindNearestLevel(rgb.green) +
+             FindNearestLevel(rgb.blue);
+
+  int average = (rgb.red + rgb.green + rgb.blue) / 3;
+  int gray_step = average < 8 ? 0 : (average - 8 + 5) / 10;
+  int gray = kFirstGray + (gray_step < kGrayLevels ? gray_step : kGrayLevels - 1);
+
+  return static_cast<unsigned char>(
+      GetDistance(rgb, GetPaletteColor(gray)) < GetDistance(rgb, GetPaletteColor(cube))
+          ? gray : cube);
+}
+
+// Returns the table that maps every entry of the 256-color palette to the
+// nearest basic color. It is computed on first use.
+const std::array<unsigned char, 256>& GetBasicColorTable() {
+  static const std::array<unsigned char, 256> table = [] {
+    std::array<unsigned char, 256> nearest;
+
+    for (int index = 0; index < 256; ++index) {
+      nearest[index] = index < 16 ? static_cast<unsigned char>(index)
+                                  : FindNearest16(GetPaletteColor(index));
+    }
+
+    return nearest;
+  }();
+
+  return table;
+}
+
+} // namespace
 
 curs::internal::ColorManager::ColorManager()
-  : current_pair_(0), start_color_(false) { }
+  : current_pair_(0), color_depth_(ColorDepth::kTrueColor), start_color_(false),
+    generation_(0) { }
 
 void curs::internal::ColorManager::StartColor() {
   if(start_color_) {
@@ -30,8 +145,28 @@ void curs::internal::ColorManager::StartColor() {
   }
 
   // Initializing a standard color pair (white text on a black background)
-  color_pairs_map_[kDefaultPair] = { 7, 0 };
+  color_pairs_[kDefaultPair] = { 7, 0 };
+  defined_pairs_.set(kDefaultPair);
+  UpdatePairCodes(kDefaultPair);
+
   start_color_ = true;
+  ++generation_;
+}
+
+void curs::internal::ColorManager::SetColorDepth(ColorDepth color_depth) {
+  if (color_depth_ == color_depth) {
+    return;
+  }
+
+  color_depth_ = color_depth;
+
+  for (PairIndex pair_index = 0; pair_index < kMaxPairs; ++pair_index) {
+    if (defined_pairs_[pair_index]) {
+      UpdatePairCodes(pair_index);
+    }
+  }
+
+  ++generation_;
 }
 
 void curs::internal::ColorManager::InitColor(ColorIndex color_index, const RGB& rgb) {
@@ -39,6 +174,10 @@ void curs::internal::ColorManager::InitColor(ColorIndex color_index, const RGB&
     return; 
   }
 
+  if (color_index < 0 || color_index >= kMaxColors) {
+    return;
+  }
+
   // Lambda function to check if the value is within the valid range (0-255)
   auto isInRange = [](short color) -> bool { 
     return color >= 0 && color <= 255; 
@@ -49,8 +188,21 @@ void curs::internal::ColorManager::InitColor(ColorIndex color_index, const RGB&
     return;
   }
 
-  // Save the custom color to the map
-  custom_colors_map_[color_index] = {rgb.red, rgb.green, rgb.blue};
+  // Save the custom color
+  custom_colors_[color_index] = {rgb.red, rgb.green, rgb.blue};
+  nearest_colors_[color_index] = {FindNearest256(rgb), FindNearest16(rgb)};
+  defined_colors_.set(color_index);
+
+  // Rebuild the sequences of every pair that uses the color
+  for (PairIndex pair_index = 0; pair_index < kMaxPairs; ++pair_index) {
+    if (defined_pairs_[pair_index] &&
+        (color_pairs_[pair_index].foreground == color_index ||
+         color_pairs_[pair_index].background == color_index)) {
+      UpdatePairCodes(pair_index);
+    }
+  }
+
+  ++generation_;
 }
 
 void curs::internal::ColorManager::InitColor(
@@ -67,8 +219,11 @@ void curs::internal::ColorManager::InitPair(PairIndex pair_index,
     return;
   }
   
-  if (pair_index > 0 && pair_index <= 255) {
-    color_pairs_map_[pair_index] = color_pair;
+  if (pair_index > 0 && pair_index < kMaxPairs) {
+    color_pairs_[pair_index] = color_pair;
+    defined_pairs_.set(pair_index);
+    UpdatePairCodes(pair_index);
+    ++generation_;
   }
 }
 
@@ -86,11 +241,11 @@ void curs::internal::ColorManager::InitDefaultPair(PairIndex pair_index) {
     return;
   }
 
-  auto color_pair = color_pairs_map_.find(pair_index);
-  
   // If a color pair exists, set it as standard
-  if (color_pair != color_pairs_map_.end()) {
-    color_pairs_map_[kDefaultPair] = color_pair->second;
+  if (IsPairDefined(pair_index)) {
+    color_pairs_[kDefaultPair] = color_pairs_[pair_index];
+    pair_codes_[kDefaultPair] = pair_codes_[pair_index];
+    ++generation_;
   }
 }
 
@@ -100,7 +255,7 @@ void curs::internal::ColorManager::SetActivePair(PairIndex pair_index) {
   }
 
   // If a color pair exists, set it as active
-  if (color_pairs_map_.find(pair_index) != color_pairs_map_.end()) {
+  if (IsPairDefined(pair_index)) {
     current_pair_ = pair_index;
   }
 }
@@ -113,88 +268,143 @@ void curs::internal::ColorManager::ResetToDefault() {
   current_pair_ = kDefaultPair;
 }
 
-std::string curs::internal::ColorManager::MakeColorCode (PairIndex pair_index) const {
-  if (!start_color_) {
-    return " ";
+const std::string& curs::internal::ColorManager::MakeColorCode (PairIndex pair_index) const {
+  if (!start_color_ || !IsPairDefined(pair_index)) {
+    return kEmptyCode; // If there is no color pair, return an empty string
   }
 
-  const auto color_pair = color_pairs_map_.find(pair_index);
-  if (color_pair == color_pairs_map_.end()) {
-    return ""; // If there is no color pair, return an empty string
+  return pair_codes_[pair_index].both;
+}
+
+const std::string& curs::internal::ColorManager::MakeColorCode (
+    PairIndex prev_pair_index,
+    PairIndex new_pair_index) const {
+  if (!start_color_ || !IsPairDefined(new_pair_index)) {
+    return kEmptyCode;
   }
 
-  std::ostringstream color_code;
+  // Without a known previous pair both colors have to be set
+  if (!IsPairDefined(prev_pair_index)) {
+    return pair_codes_[new_pair_index].both;
+  }
 
-  // Add an ESC sequence for the text color
-  const auto color_index_fg = custom_colors_map_.find(color_pair->second.foreground);
-  
-  if (color_index_fg != custom_colors_map_.end()) {
-    MakeEscapeSequenceRGB(color_code, ColorType::Text, color_index_fg->second);
-  } else {
-    MakeEscapeSequence256Color(color_code, ColorType::Text, color_pair->second.foreground);
+  const ColorPair& prev_pair = color_pairs_[prev_pair_index];
+  const ColorPair& new_pair = color_pairs_[new_pair_index];
+
+  bool is_foreground_changed = prev_pair.foreground != new_pair.foreground;
+  bool is_background_changed = prev_pair.background != new_pair.background;
+
+  // Only the colors that differ are updated
+  if (is_foreground_changed && is_background_changed) {
+    return pair_codes_[new_pair_index].both;
   }
 
-  // Add an ESC sequence for the background color
-  const auto color_index_bg = custom_colors_map_.find(color_pair->second.background);
+  if (is_foreground_changed) {
+    return pair_codes_[new_pair_index].foreground;
+  }
 
-  if (color_index_bg != custom_colors_map_.end()) {
-    MakeEscapeSequenceRGB(color_code, ColorType::Background, color_index_bg->second);
-  } else {
-    MakeEscapeSequence256Color(color_code, ColorType::Background, color_pair->second.background);
+  if (is_background_changed) {
+    return pair_codes_[new_pair_index].background;
   }
 
-  return color_code.str();
+  return kEmptyCode;
 }
 
-std::string curs::internal::ColorManager::MakeColorCode (
-    PairIndex prev_pair_index,
-    PairIndex new_pair_index) const {
-  if (!start_color_) {
-    return "";
+void curs::internal::ColorManager::UpdatePairCodes(PairIndex pair_index) {
+  const ColorPair& color_pair = color_pairs_[pair_index];
+  PairCodes& codes = pair_codes_[pair_index];
+
+  // Without colors there is nothing to set.
+  if (color_depth_ == ColorDepth::kMonochrome) {
+    codes = PairCodes();
+    return;
   }
 
-  const auto first_pair  = color_pairs_map_.find(prev_pair_index);
-  const auto second_pair = color_pairs_map_.find(new_pair_index);
+  // Example format: "\033[38;5;<fg>m", "\033[48;5;<bg>m" and, for both
+  // colors at once, "\033[38;5;<fg>;48;5;<bg>m"
+  codes.foreground = "\033[";
+  AppendColorParameters(codes.foreground, ColorType::Text, color_pair.foreground);
+  codes.foreground += 'm';
+
+  codes.background = "\033[";
+  AppendColorParameters(codes.background, ColorType::Background, color_pair.background);
+  codes.background += 'm';
+
+  codes.both = "\033[";
+  AppendColorParameters(codes.both, ColorType::Text, color_pair.foreground);
+  codes.both += ';';
+  AppendColorParameters(codes.both, ColorType::Background, color_pair.background);
+  codes.both += 'm';
+}
 
-  // If at least one of the pairs is missing, return an empty string
-  if (first_pair == color_pairs_map_.end() && second_pair == color_pairs_map_.end())  {
-    return ""; 
+void curs::internal::ColorManager::AppendColorParameters(
+    std::string& color_code,
+    ColorType color_type,
+    short color_index) const {
+  bool is_custom = color_index >= 0 && color_index < kMaxColors && defined_colors_[color_index];
+
+  switch (color_depth_) {
+    case ColorDepth::kTrueColor:
+      if (is_custom) {
+        MakeEscapeSequenceRGB(color_code, color_type, custom_colors_[color_index]);
+      } else {
+        MakeEscapeSequence256Color(color_code, color_type, color_index);
+      }
+      break;
+
+    case ColorDepth::k256:
+      MakeEscapeSequence256Color(
+          color_code, color_type,
+          is_custom ? nearest_colors_[color_index].palette256 : color_index);
+      break;
+
+    case ColorDepth::k16:
+      if (is_custom) {
+        color_index = nearest_colors_[color_index].palette16;
+      } else if (color_index >= 0 && color_index < 256) {
+        color_index = GetBasicColorTable()[color_index];
+      }
+
+      MakeEscapeSequence16Color(color_code, color_type, color_index);
+      break;
+
+    case ColorDepth::kMonochrome:
+      break;
   }
+}
 
-  std::ostringstream color_code;
-
-  // If the text color is different, update it
-  if (first_pair->second.foreground != second_pair->second.foreground) {
-    const auto color_index_fg = custom_colors_map_.find(second_pair->second.foreground);
+void curs::internal::ColorManager::MakeEscapeSequence16Color(
+    std::string& color_code,
+    ColorType color_type,
+    short color_index) const {
+  // Generates the parameter for setting text or background color
+  // to one of the basic colors.
+  // Example format: "31" (text), "41" (background), "91"/"101" (bright variants)
 
-    if (color_index_fg != custom_colors_map_.end()) {
-      MakeEscapeSequenceRGB(color_code, ColorType::Text, color_index_fg->second);
-    } else {
-      MakeEscapeSequence256Color(color_code, ColorType::Text, second_pair->second.foreground);
-    }
+  // Only process valid color types (Text or Background).
+  if(color_type != ColorType::Text &&
+     color_type != ColorType::Background) {
+    return;
   }
 
-  // If the background has changed, update it
-  if (first_pair->second.background != second_pair->second.background) {
-    const auto color_index_bg = custom_colors_map_.find(second_pair->second.background);
+  int base = static_cast<int>(color_type) - 8; // 30 for text color, 40 for background color
 
-    if (color_index_bg != custom_colors_map_.end()) {
-      MakeEscapeSequenceRGB(color_code, ColorType::Background, color_index_bg->second);
-    } else {
-      MakeEscapeSequence256Color(color_code, ColorType::Background, second_pair->second.background);
-    }
+  if (color_index < 0 || color_index >= 16) {
+    AppendNumber(color_code, base + 9);        // The terminal's default color
+  } else if (color_index < 8) {
+    AppendNumber(color_code, base + color_index);
+  } else {
+    AppendNumber(color_code, base + 60 + color_index - 8);
   }
-
-  return color_code.str();
 }
 
 void curs::internal::ColorManager::MakeEscapeSequence256Color(
-    std::ostringstream& color_code,
+    std::string& color_code,
     ColorType color_type, 
     short color_index) const {
-  // Generates an ANSI escape sequence for setting
+  // Generates the parameters for setting
   // text or background color using the 256-color palette.
-  // Example format: "\033[<38/48>;5;<color_index>m"
+  // Example format: "<38/48>;5;<color_index>"
 
   // Only process valid color types (Text or Background).
   if(color_type != ColorType::Text &&
@@ -202,21 +412,18 @@ void curs::internal::ColorManager::MakeEscapeSequence256Color(
    return;
   }
  
-  // Append ANSI escape sequence prefix and color code
-  color_code << "\033["
-  << static_cast<short>(color_type) // 38 sets text color, 48 sets background color 
-  << ";5;"                          // '5' indicates the 256-color palette
-  << color_index                    // Color index in the palette
-  << "m";                           // 'm' marks the end of the sequence
+  AppendNumber(color_code, static_cast<int>(color_type)); // 38 sets text color, 48 sets background color 
+  color_code += ";5;";                                    // '5' indicates the 256-color palette
+  AppendNumber(color_code, color_index);                  // Color index in the palette
 }
 
 void curs::internal::ColorManager::MakeEscapeSequenceRGB(
-    std::ostringstream& color_code,
+    std::string& color_code,
     ColorType color_type,
     const RGB& rbg) const {
-  // Generates an ANSI escape sequence for setting 
+  // Generates the parameters for setting 
   // text or background color using RGB values.
-  // Example format: "\033[<38/48>;2;<red>;<green>;<blue>m"
+  // Example format: "<38/48>;2;<red>;<green>;<blue>"
 
   // Only process valid color types (Text or Background)..
   if(color_type != ColorType::Text &&
@@ -224,12 +431,11 @@ void curs::internal::ColorManager::MakeEscapeSequenceRGB(
     return;
   }
 
-  // Append ANSI escape sequence prefix and color code
-  color_code << "\033[" 
-  << static_cast<short>(color_type) // 38 for text color, 48 for background color
-  << ";2;"                          // '2' indicates RGB color format
-  << rbg.red << ";"                 // Red component
-  << rbg.green << ";"               // Green component
-  << rbg.blue                       // Blue component
-  << "m";                           // 'm' marks the end of the sequence
-}
\ No newline at end of file
+  AppendNumber(color_code, static_cast<int>(color_type)); // 38 for text color, 48 for background color
+  color_code += ";2;";                                    // '2' indicates RGB color format
+  AppendNumber(color_code, rbg.red);                      // Red component
+  color_code += ';';
+  AppendNumber(color_code, rbg.green);                    // Green component
+  color_code += ';';
+  AppendNumber(color_code, rbg.blue);                     // Blue component
+}
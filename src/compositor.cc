@@ -0,0 +1,319 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wcurses/compositor.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "wcurses/cell_grid.h"
+#include "wcurses/layer.h"
+#include "wcurses/structures.h"
+#include "wcurses/unicode.h"
+
+curs::internal::Compositor::Compositor() = default;
+
+curs::internal::Compositor::~Compositor() = default;
+
+curs::Layer* curs::internal::Compositor::NewLayer(Buffer* buffer, const Rect& rect) {
+  // The composed grid starts out as a copy of the buffer.
+  if (!is_active_) {
+    is_active_ = true;
+    is_full_compose_ = true;
+  }
+
+  layers_.emplace_back(new Layer(this, buffer, rect));
+  Expose(layers_.back()->rect_);
+
+  return layers_.back().get();
+}
+
+void curs::internal::Compositor::DeleteLayer(Layer* layer) {
+  auto found = Find(layer);
+
+  if (found == layers_.end()) {
+    return;
+  }
+
+  if (layer->is_visible_) {
+    Expose(layer->rect_);
+  }
+
+  layers_.erase(found);
+}
+
+void curs::internal::Compositor::Raise(Layer* layer) {
+  auto found = Find(layer);
+
+  if (found == layers_.end() || found + 1 == layers_.end()) {
+    return;
+  }
+
+  std::rotate(found, found + 1, layers_.end());
+
+  if (layer->is_visible_) {
+    Expose(layer->rect_);
+  }
+}
+
+void curs::internal::Compositor::Lower(Layer* layer) {
+  auto found = Find(layer);
+
+  if (found == layers_.end() || found == layers_.begin()) {
+    return;
+  }
+
+  std::rotate(layers_.begin(), found, found + 1);
+
+  if (layer->is_visible_) {
+    Expose(layer->rect_);
+  }
+}
+
+const curs::internal::CellGrid& curs::internal::Compositor::Compose(CellGrid& base) {
+  if (!is_active_) {
+    return base;
+  }
+
+  // Layers write their characters into the table of the buffer.
+  if (composed_.GetGraphemes().GetSize() != base.GetGraphemes().GetSize()) {
+    composed_.GetGraphemes().CopyNewEntries(base.GetGraphemes());
+  }
+
+  const short rows = base.GetRows();
+  const short cols = base.GetCols();
+  const bool is_full = is_full_compose_ || composed_.GetRows() != rows || composed_.GetCols() != cols;
+
+  if (is_full) {
+    composed_.Resize(base.GetSize());
+    row_spans_.assign(rows, DirtySpan{0, cols});
+    is_full_compose_ = false;
+  } else {
+    row_spans_.assign(rows, DirtySpan{std::numeric_limits<short>::max(), 0});
+    ForwardScrolls(base);
+
+    if (base.IsDirty()) {
+      for (short y = 0; y < rows; ++y) {
+        const DirtySpan& span = base.GetDirtySpan(y);
+
+        if (!span.IsClean()) {
+          AddSpan(y, span.begin, span.end);
+        }
+      }
+    }
+
+    for (const std::unique_ptr<Layer>& layer : layers_) {
+      if (!layer->is_visible_ || !layer->cells_.IsDirty()) {
+        continue;
+      }
+
+      const Rect& rect = layer->rect_;
+
+      for (short y = 0; y < rect.rows && rect.y + y < rows; ++y) {
+        const DirtySpan& span = layer->cells_.GetDirtySpan(y);
+
+        if (!span.IsClean()) {
+          AddSpan(static_cast<short>(rect.y + y), rect.x + span.begin, rect.x + span.end);
+        }
+      }
+    }
+
+    for (const Rect& rect : exposed_) {
+      AddRect(rect);
+    }
+  }
+
+  for (short y = 0; y < rows; ++y) {
+    const DirtySpan& span = row_spans_[y];
+
+    if (span.IsClean()) {
+      continue;
+    }
+
+    // The neighbours of the span may hold the other half of a wide
+    // character whose source changed.
+    const short begin = std::max<short>(0, span.begin - 1);
+    const short end = std::min<short>(cols, span.end + 1);
+
+    ComposeSpan(base, y, begin, end);
+    composed_.MarkDirty(y, begin, end);
+  }
+
+  if (is_full) {
+    composed_.MarkAllDirty();
+  }
+
+  return composed_;
+}
+
+void curs::internal::Compositor::ClearDamage() {
+  if (!is_active_) {
+    return;
+  }
+
+  composed_.ClearDamage();
+  exposed_.clear();
+
+  for (const std::unique_ptr<Layer>& layer : layers_) {
+    layer->cells_.ClearDamage();
+  }
+}
+
+std::vector<std::unique_ptr<curs::Layer>>::iterator curs::internal::Compositor::Find(Layer* layer) {
+  return std::find_if(layers_.begin(), layers_.end(),
+                      [layer](const std::unique_ptr<Layer>& item) { return item.get() == layer; });
+}
+
+void curs::internal::Compositor::AddSpan(short y, int begin, int end) {
+  if (y < 0 || y >= static_cast<short>(row_spans_.size())) {
+    return;
+  }
+
+  DirtySpan& span = row_spans_[y];
+  const int cols = composed_.GetCols();
+
+  begin = std::max(begin, 0);
+  end = std::min(end, cols);
+
+  if (begin >= end) {
+    return;
+  }
+
+  span.begin = std::min<short>(span.begin, static_cast<short>(begin));
+  span.end = std::max<short>(span.end, static_cast<short>(end));
+}
+
+void curs::internal::Compositor::AddRect(const Rect& rect) {
+  const int last = std::min<int>(rect.y + rect.rows, static_cast<int>(row_spans_.size()));
+
+  for (int y = std::max<int>(rect.y, 0); y < last; ++y) {
+    AddSpan(static_cast<short>(y), rect.x, rect.x + rect.cols);
+  }
+}
+
+void curs::internal::Compositor::ForwardScrolls(const CellGrid& base) {
+  const short cols = base.GetCols();
+  bool is_blocked = false;
+
+  auto overlaps = [](const Rect& rect, const ScrollOp& scroll) {
+    return rect.y <= scroll.bottom && rect.y + rect.rows > scroll.top;
+  };
+
+  for (const ScrollOp& scroll : base.GetScrolls()) {
+    // Once a scroll could not be repeated, the rows of the composed grid no
+    // longer match the rows of base that later scrolls move.
+    for (auto layer = layers_.begin(); layer != layers_.end() && !is_blocked; ++layer) {
+      is_blocked = (*layer)->is_visible_ && overlaps((*layer)->rect_, scroll);
+    }
+
+    for (auto rect = exposed_.begin(); rect != exposed_.end() && !is_blocked; ++rect) {
+      is_blocked = overlaps(*rect, scroll);
+    }
+
+    // Rows that scroll in are damaged in base and merged below.
+    if (!is_blocked) {
+      composed_.Scroll(scroll.top, scroll.bottom, scroll.count);
+      continue;
+    }
+
+    for (short y = scroll.top; y <= scroll.bottom; ++y) {
+      AddSpan(y, 0, cols);
+    }
+  }
+}
+
+void curs::internal::Compositor::ComposeSpan(const CellGrid& base, short y, short begin, short end) {
+  uncovered_.clear();
+  uncovered_.push_back({begin, end});
+
+  // Each layer takes the parts of the span it covers, from the top down;
+  // the layers below never see them.
+  for (auto it = layers_.rbegin(); it != layers_.rend() && !uncovered_.empty(); ++it) {
+    const Layer& layer = **it;
+    const Rect& rect = layer.rect_;
+
+    if (!layer.is_visible_ || y < rect.y || y >= rect.y + rect.rows) {
+      continue;
+    }
+
+    const short left = rect.x;
+    const short right = static_cast<short>(std::min<int>(rect.x + rect.cols, composed_.GetCols()));
+
+    next_uncovered_.clear();
+
+    for (const Interval& interval : uncovered_) {
+      if (interval.end <= left || interval.begin >= right) {
+        next_uncovered_.push_back(interval);
+        continue;
+      }
+
+      const short covered_begin = std::max(interval.begin, left);
+      const short covered_end = std::min(interval.end, right);
+
+      CopySegment(base, layer.cells_, static_cast<short>(y - rect.y), rect.x,
+                  y, covered_begin, covered_end);
+
+      if (interval.begin < covered_begin) {
+        next_uncovered_.push_back({interval.begin, covered_begin});
+      }
+
+      if (covered_end < interval.end) {
+        next_uncovered_.push_back({covered_end, interval.end});
+      }
+    }
+
+    uncovered_.swap(next_uncovered_);
+  }
+
+  for (const Interval& interval : uncovered_) {
+    CopySegment(base, base, y, 0, y, interval.begin, interval.end);
+  }
+}
+
+void curs::internal::Compositor::CopySegment(const CellGrid& base, const CellGrid& source,
+                                             short source_y, short origin_x,
+                                             short y, short begin, short end) {
+  const ChType* from = source.Row(source_y);
+  ChType* to = composed_.Row(y);
+  const short source_end = end - origin_x;
+
+  std::copy(from + (begin - origin_x), from + source_end, to + begin);
+
+  if (to[begin].symbol == kWideContinuation &&
+      (begin == 0 || &GetOwner(base, y, begin - 1) != &source)) {
+    to[begin].symbol = U' ';
+  }
+
+  if (source_end < source.GetCols() && from[source_end].symbol == kWideContinuation &&
+      (end == composed_.GetCols() || &GetOwner(base, y, end) != &source)) {
+    to[end - 1].symbol = U' ';
+  }
+}
+
+const curs::internal::CellGrid& curs::internal::Compositor::GetOwner(const CellGrid& base,
+                                                                    short y, short x) const {
+  for (auto it = layers_.rbegin(); it != layers_.rend(); ++it) {
+    const Rect& rect = (*it)->rect_;
+
+    if ((*it)->is_visible_ && y >= rect.y && y < rect.y + rect.rows &&
+        x >= rect.x && x < rect.x + rect.cols) {
+      return (*it)->cells_;
+    }
+  }
+
+  return base;
+}
@@ -17,6 +17,9 @@
 
 #include "wcurses/point.h"
 
+constexpr short curs::internal::Cursor::kMinCursor;
+constexpr short curs::internal::Cursor::kMinLimit;
+
 curs::internal::Cursor::Cursor()
   : cursor_(kMinCursor, kMinCursor), limit_(kMinLimit, kMinLimit) {}
 
@@ -0,0 +1,207 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _WIN32
+
+#include "wcurses/input_manager.h"
+
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+#include "wcurses/key.h"
+
+namespace curs {
+namespace internal {
+
+const InputManager::KeyMap InputManager::key_map_ {
+  {8,   Key::kBackspace},
+  {9,   Key::kTab},
+  {10,  Key::kEnter},
+  {13,  Key::kEnter},
+  {127, Key::kBackspace},
+};
+
+const InputManager::SequenceMap InputManager::sequence_map_ {
+  {"[A",   Key::kArrowUp},
+  {"[B",   Key::kArrowDown},
+  {"[C",   Key::kArrowRight},
+  {"[D",   Key::kArrowLeft},
+  {"OA",   Key::kArrowUp},
+  {"OB",   Key::kArrowDown},
+  {"OC",   Key::kArrowRight},
+  {"OD",   Key::kArrowLeft},
+  {"[2~",  Key::kInsert},
+  {"[3~",  Key::kDelete},
+  {"[5~",  Key::kPageUp},
+  {"[6~",  Key::kPageDown},
+  {"OP",   Key::kF1},
+  {"OQ",   Key::kF2},
+  {"OR",   Key::kF3},
+  {"OS",   Key::kF4},
+  {"[11~", Key::kF1},
+  {"[12~", Key::kF2},
+  {"[13~", Key::kF3},
+  {"[14~", Key::kF4},
+  {"[15~", Key::kF5},
+  {"[17~", Key::kF6},
+  {"[18~", Key::kF7},
+  {"[19~", Key::kF8},
+  {"[20~", Key::kF9},
+  {"[21~", Key::kF10},
+  {"[23~", Key::kF11},
+  {"[24~", Key::kF12},
+};
+
+constexpr int InputManager::kEscapeDelay;
+
+} // namespace internal
+} // namespace curs
+
+void curs::internal::InputManager::Clear() {
+  // Discard both the bytes still queued in the terminal and the ones
+  // read ahead while decoding escape sequences.
+  tcflush(STDIN_FILENO, TCIFLUSH);
+  input_.clear();
+}
+
+// The GetCh() method decodes the bytes sent by the terminal into
+// ncurses-compatible key codes. Function keys arrive as escape sequences,
+// which are looked up in `sequence_map_`.
+int curs::internal::InputManager::GetCh() {
+  // If `no_delay_` mode is enabled and no key is pressed, return an error code.
+  if (input_.empty() && !ReadInput(no_delay_ ? 0 : -1)) {
+    return kErr;
+  }
+
+  int key_code = static_cast<unsigned char>(input_[0]);
+
+  if (key_code == static_cast<int>(Key::kEscape)) {
+    std::size_t length = GetSequenceLength();
+
+    // The terminal may deliver a sequence in several pieces.
+    while (length == 0 && ReadInput(kEscapeDelay)) {
+      length = GetSequenceLength();
+    }
+
+    // Nothing followed: the Escape key itself.
+    if (length == 0 && input_.size() == 1) {
+      length = 1;
+    }
+
+    // Drop the rest of a sequence that never completed.
+    if (length == 0) {
+      input_.clear();
+      return kErr;
+    }
+
+    std::string sequence = input_.substr(1, length - 1);
+    input_.erase(0, length);
+
+    if (sequence.empty()) {
+      return key_code;
+    }
+
+    auto sequence_it = sequence_map_.find(sequence);
+    if (sequence_it != sequence_map_.end()) {
+      return static_cast<int>(sequence_it->second);
+    }
+
+    return kErr;
+  }
+
+  input_.erase(0, 1);
+
+  // If the key is a printable ASCII character (from ' ' to '~'),
+  // return it directly
+  if (key_code >= static_cast<int>(Key::kSpace) &&
+      key_code <= static_cast<int>(Key::kTilde)) {
+    return key_code;
+  }
+
+  // Check if the key exists in `key_map_`, which stores mappings
+  // for common keys like Enter, Backspace, and Tab
+  auto key_it = key_map_.find(static_cast<short>(key_code));
+  if (key_it != key_map_.end()) {
+    return static_cast<int>(key_it->second);
+  }
+
+  return kErr;
+}
+
+curs::Key curs::internal::InputManager::GetKey() {
+  return static_cast<Key>(GetCh());
+}
+
+curs::internal::InputManager& curs::internal::InputManager::operator>>(int& key_code) {
+  key_code = GetCh();
+  return *this;
+}
+
+curs::internal::InputManager& curs::internal::InputManager::operator>>(Key& key_code) {
+  key_code = GetKey();
+  return *this;
+}
+
+bool curs::internal::InputManager::ReadInput(int timeout) {
+  pollfd input = {STDIN_FILENO, POLLIN, 0};
+
+  // A signal (e.g. a resize of the terminal) also ends the wait.
+  if (poll(&input, 1, timeout) <= 0) {
+    return false;
+  }
+
+  char bytes[64];
+  ssize_t length = read(STDIN_FILENO, bytes, sizeof(bytes));
+
+  if (length <= 0) {
+    return false;
+  }
+
+  input_.append(bytes, static_cast<std::size_t>(length));
+  return true;
+}
+
+std::size_t curs::internal::InputManager::GetSequenceLength() const {
+  if (input_.size() < 2) {
+    return 0;
+  }
+
+  // "ESC O <key>": the keys of the keypad in application mode.
+  if (input_[1] == 'O') {
+    return input_.size() < 3 ? 0 : 3;
+  }
+
+  // Any other key after ESC is not part of a sequence (e.g. Alt+key).
+  if (input_[1] != '[') {
+    return 1;
+  }
+
+  // "ESC [ <parameters> <final byte>", the final byte is in '@'..'~'.
+  for (std::size_t i = 2; i < input_.size(); ++i) {
+    if (input_[i] >= '@' && input_[i] <= '~') {
+      return i + 1;
+    }
+  }
+
+  return 0;
+}
+
+#endif // _WIN32
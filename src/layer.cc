@@ -0,0 +1,68 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wcurses/layer.h"
+
+#include <algorithm>
+
+#include "wcurses/cell_grid.h"
+#include "wcurses/color_manager.h"
+#include "wcurses/compositor.h"
+#include "wcurses/structures.h"
+#include "wcurses/window.h"
+
+curs::Layer::Layer(internal::Compositor* compositor, internal::Buffer* buffer, const Rect& rect)
+    : compositor_(compositor),
+      cells_(Size{std::max<short>(1, rect.rows), std::max<short>(1, rect.cols)}),
+      rect_{std::max<short>(0, rect.y), std::max<short>(0, rect.x), cells_.GetRows(), cells_.GetCols()},
+      window_(buffer, {0, 0, rect_.rows, rect_.cols}, &cells_) {
+  cells_.Fill({U' ', Attr::kNormal, internal::ColorManager::GetDefaultPair()});
+  cells_.ClearDamage();
+}
+
+void curs::Layer::Show() {
+  if (!is_visible_) {
+    is_visible_ = true;
+    compositor_->Expose(rect_);
+  }
+}
+
+void curs::Layer::Hide() {
+  if (is_visible_) {
+    is_visible_ = false;
+    compositor_->Expose(rect_);
+  }
+}
+
+void curs::Layer::Raise() {
+  compositor_->Raise(this);
+}
+
+void curs::Layer::Lower() {
+  compositor_->Lower(this);
+}
+
+void curs::Layer::Move(short y, short x) {
+  if (is_visible_) {
+    compositor_->Expose(rect_);
+  }
+
+  rect_.y = std::max<short>(0, y);
+  rect_.x = std::max<short>(0, x);
+
+  if (is_visible_) {
+    compositor_->Expose(rect_);
+  }
+}
@@ -0,0 +1,40 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wcurses/number_format.h"
+
+#include <cstdio>
+
+#include "wcurses/structures.h"
+
+std::size_t curs::internal::FormatFloat(double value, int precision,
+                                        FloatFormat format,
+                                        char* buffer, std::size_t size) {
+  const char* pattern = format == FloatFormat::kGeneral ? "%.*g" : "%.*f";
+
+  int length = std::snprintf(buffer, size, pattern, precision < 0 ? 0 : precision, value);
+
+  return length < 0 ? 0 : static_cast<std::size_t>(length);
+}
+
+std::size_t curs::internal::FormatFloat(long double value, int precision,
+                                        FloatFormat format,
+                                        char* buffer, std::size_t size) {
+  const char* pattern = format == FloatFormat::kGeneral ? "%.*Lg" : "%.*Lf";
+
+  int length = std::snprintf(buffer, size, pattern, precision < 0 ? 0 : precision, value);
+
+  return length < 0 ? 0 : static_cast<std::size_t>(length);
+}
@@ -0,0 +1,324 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wcurses/pad.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "wcurses/cell_grid.h"
+#include "wcurses/color_manager.h"
+#include "wcurses/number_format.h"
+#include "wcurses/point.h"
+#include "wcurses/structures.h"
+#include "wcurses/unicode.h"
+
+constexpr long curs::Pad::kChunkRows;
+constexpr long curs::Pad::kChunkCols;
+
+curs::Pad::Pad(long rows, long cols)
+    : rows_(std::max(rows, 1L)),
+      cols_(std::max(cols, 1L)),
+      chunks_across_((cols_ + kChunkCols - 1) / kChunkCols) {}
+
+curs::Pad& curs::Pad::operator<<(char ch) {
+  return Write(&ch, 1);
+}
+
+curs::Pad& curs::Pad::operator<<(const char* str) {
+  return Write(str, std::strlen(str));
+}
+
+curs::Pad& curs::Pad::operator<<(const std::string& str) {
+  return Write(str.data(), str.size());
+}
+
+template <typename T>
+curs::Pad& curs::Pad::WriteInteger(T val) {
+  char digits[internal::kMaxIntegerLength];
+  char* digits_end = digits + internal::kMaxIntegerLength;
+  char* first = internal::FormatInteger(val, digits_end);
+
+  return Write(first, digits_end - first);
+}
+
+curs::Pad& curs::Pad::operator<<(int val) {
+  return WriteInteger(val);
+}
+
+curs::Pad& curs::Pad::operator<<(long val) {
+  return WriteInteger(val);
+}
+
+curs::Pad& curs::Pad::operator<<(long long val) {
+  return WriteInteger(val);
+}
+
+curs::Pad& curs::Pad::operator<<(unsigned val) {
+  return WriteInteger(val);
+}
+
+curs::Pad& curs::Pad::operator<<(unsigned long val) {
+  return WriteInteger(val);
+}
+
+curs::Pad& curs::Pad::operator<<(unsigned long long val) {
+  return WriteInteger(val);
+}
+
+curs::Pad& curs::Pad::operator<<(double val) {
+  char digits[internal::kFloatBufferSize];
+  std::size_t length = internal::FormatFloat(val, 6, FloatFormat::kFixed, digits, sizeof(digits));
+
+  if (length < sizeof(digits)) {
+    return Write(digits, length);
+  }
+
+  // Only huge values in fixed notation do not fit on the stack.
+  std::string long_digits(length + 1, '\0');
+  internal::FormatFloat(val, 6, FloatFormat::kFixed, &long_digits[0], long_digits.size());
+
+  return Write(long_digits.data(), length);
+}
+
+curs::Pad& curs::Pad::Write(const char* str, std::size_t length) {
+  const char* end = str + length;
+
+  // Complete a character that the previous write ended in the middle of.
+  while (utf8_pending_length_ > 0 && str < end) {
+    utf8_pending_[utf8_pending_length_++] = *str++;
+    PutPendingUtf8();
+  }
+
+  while (str < end) {
+    if (*str == '\n') {
+      NewLine();
+      ++str;
+      continue;
+    }
+
+    if (static_cast<unsigned char>(*str) >= 0x80) {
+      char32_t code_point;
+      std::size_t sequence_length = internal::DecodeUtf8(str, end - str, &code_point);
+
+      // The rest of the character comes with the next write.
+      if (sequence_length == 0) {
+        std::memcpy(utf8_pending_, str, end - str);
+        utf8_pending_length_ = end - str;
+        break;
+      }
+
+      PutCodePoint(code_point);
+      str += sequence_length;
+      continue;
+    }
+
+    // Copy the ASCII text up to the end of the row segment of the chunk.
+    long count;
+    internal::ChType* cells = GetCells(cursor_.y, cursor_.x, &count);
+    long ascii_count = 0;
+
+    while (ascii_count < count && str + ascii_count < end &&
+           static_cast<unsigned char>(str[ascii_count]) < 0x80 && str[ascii_count] != '\n') {
+      ++ascii_count;
+    }
+
+    BreakWideCharacters(cursor_.y, cursor_.x, cursor_.x + ascii_count);
+
+    for (long i = 0; i < ascii_count; ++i) {
+      cells[i] = {static_cast<unsigned char>(str[i]), attributes_, pair_};
+    }
+
+    str += ascii_count;
+
+    if (cursor_.x + ascii_count >= cols_) {
+      cursor_.x = cols_ - 1;
+      NewLine();
+    } else {
+      cursor_.x += ascii_count;
+    }
+  }
+
+  return *this;
+}
+
+void curs::Pad::MoveTo(long y, long x) {
+  cursor_.y = std::max(0L, std::min(y, rows_ - 1));
+  cursor_.x = std::max(0L, std::min(x, cols_ - 1));
+}
+
+void curs::Pad::Clear() {
+  chunks_.clear();
+  cached_key_ = -1;
+  cached_chunk_ = nullptr;
+  cursor_ = {0, 0};
+}
+
+curs::internal::ChType* curs::Pad::FindChunk(long long key) const {
+  if (key == cached_key_) {
+    return cached_chunk_;
+  }
+
+  auto found = chunks_.find(key);
+
+  if (found == chunks_.end()) {
+    return nullptr;
+  }
+
+  cached_key_ = key;
+  cached_chunk_ = found->second.get();
+  return cached_chunk_;
+}
+
+curs::internal::ChType* curs::Pad::GetCells(long y, long x, long* count) {
+  const long long key = static_cast<long long>(y / kChunkRows) * chunks_across_ + x / kChunkCols;
+  internal::ChType* chunk = FindChunk(key);
+
+  if (chunk == nullptr) {
+    Chunk cells(new internal::ChType[kChunkRows * kChunkCols]);
+    std::fill_n(cells.get(), kChunkRows * kChunkCols,
+                internal::ChType{U' ', Attr::kNormal, internal::ColorManager::GetDefaultPair()});
+
+    chunk = cells.get();
+    chunks_.emplace(key, std::move(cells));
+    cached_key_ = key;
+    cached_chunk_ = chunk;
+  }
+
+  const long chunk_x = x % kChunkCols;
+  *count = std::min(kChunkCols - chunk_x, cols_ - x);
+
+  return chunk + (y % kChunkRows) * kChunkCols + chunk_x;
+}
+
+const curs::internal::ChType* curs::Pad::FindCells(long y, long x, long* count) const {
+  if (y < 0 || y >= rows_ || x >= cols_) {
+    *count = std::numeric_limits<long>::max();
+    return nullptr;
+  }
+
+  if (x < 0) {
+    *count = -x;
+    return nullptr;
+  }
+
+  const internal::ChType* chunk =
+      FindChunk(static_cast<long long>(y / kChunkRows) * chunks_across_ + x / kChunkCols);
+  const long chunk_x = x % kChunkCols;
+  *count = std::min(kChunkCols - chunk_x, cols_ - x);
+
+  return chunk != nullptr ? chunk + (y % kChunkRows) * kChunkCols + chunk_x : nullptr;
+}
+
+curs::internal::ChType curs::Pad::GetCell(long y, long x) const {
+  long count;
+  const internal::ChType* cell = FindCells(y, x, &count);
+
+  return cell != nullptr ? *cell
+                         : internal::ChType{U' ', Attr::kNormal, internal::ColorManager::GetDefaultPair()};
+}
+
+void curs::Pad::PutCodePoint(char32_t code_point) {
+  const int width = internal::GetCharWidth(code_point);
+  long count;
+
+  // Combining characters, the characters after a zero width joiner and the
+  // second half of a flag are part of the character before them.
+  if (cursor_.x > 0 || cursor_.y > 0) {
+    long y = cursor_.x > 0 ? cursor_.y : cursor_.y - 1;
+    long x = cursor_.x > 0 ? cursor_.x - 1 : cols_ - 1;
+
+    if (x > 0 && GetCell(y, x).symbol == internal::kWideContinuation) {
+      --x;
+    }
+
+    const char32_t previous = GetCell(y, x).symbol;
+
+    if (width == 0 || internal::JoinsPrevious(graphemes_, previous, code_point)) {
+      GetCells(y, x, &count)->symbol = graphemes_.Append(previous, code_point);
+      return;
+    }
+  }
+
+  if (width == 0) {
+    return;
+  }
+
+  // A wide character that does not fit into the last column goes to the
+  // next row, unless the cursor stays on the bottom row.
+  if (width == 2 && cursor_.x == cols_ - 1) {
+    Write(" ", 1);
+
+    if (cursor_.x == cols_ - 1) {
+      return;
+    }
+  }
+
+  BreakWideCharacters(cursor_.y, cursor_.x, cursor_.x + width);
+
+  *GetCells(cursor_.y, cursor_.x, &count) = {code_point, attributes_, pair_};
+
+  // The right half may start the next chunk.
+  if (width == 2) {
+    *GetCells(cursor_.y, cursor_.x + 1, &count) = {internal::kWideContinuation, attributes_, pair_};
+  }
+
+  if (cursor_.x + width >= cols_) {
+    cursor_.x = cols_ - 1;
+    NewLine();
+  } else {
+    cursor_.x += width;
+  }
+}
+
+void curs::Pad::PutPendingUtf8() {
+  char32_t code_point;
+  std::size_t sequence_length = internal::DecodeUtf8(utf8_pending_, utf8_pending_length_, &code_point);
+
+  if (sequence_length == 0) {
+    return;
+  }
+
+  // After an invalid byte the remaining bytes start over.
+  char rest[internal::kMaxUtf8Length];
+  std::size_t rest_length = utf8_pending_length_ - sequence_length;
+  std::memcpy(rest, utf8_pending_ + sequence_length, rest_length);
+  utf8_pending_length_ = 0;
+
+  PutCodePoint(code_point);
+  Write(rest, rest_length);
+}
+
+void curs::Pad::NewLine() {
+  if (cursor_.y < rows_ - 1) {
+    ++cursor_.y;
+    cursor_.x = 0;
+  }
+}
+
+void curs::Pad::BreakWideCharacters(long y, long begin, long end) {
+  long count;
+
+  if (begin > 0 && GetCell(y, begin).symbol == internal::kWideContinuation) {
+    GetCells(y, begin - 1, &count)->symbol = U' ';
+  }
+
+  if (end < cols_ && GetCell(y, end).symbol == internal::kWideContinuation) {
+    GetCells(y, end, &count)->symbol = U' ';
+  }
+}
@@ -0,0 +1,174 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "wcurses/render_thread.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "wcurses/cell_grid.h"
+#include "wcurses/color_manager.h"
+#include "wcurses/point.h"
+#include "wcurses/renderer.h"
+#include "wcurses/structures.h"
+#include "wcurses/terminal.h"
+
+curs::internal::RenderThread::RenderThread(Terminal& terminal,
+                                           const FrameStats& frame_stats)
+    : terminal_(terminal), frame_stats_(frame_stats) {
+  // Started last, when every member it uses is ready.
+  thread_ = std::thread(&RenderThread::Run, this);
+}
+
+curs::internal::RenderThread::~RenderThread() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+
+  frame_ready_.notify_one();
+  thread_.join();
+}
+
+bool curs::internal::RenderThread::Publish(const CellGrid& grid,
+                                           const ColorManager& color_manager,
+                                           const Point& cursor, bool cursor_visible) {
+  bool was_pending;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Only the changes are copied, the pending grid keeps the rest.
+    pending_grid_.CopyChanges(grid);
+
+    // Colors change rarely, and then they invalidate the whole frame anyway.
+    if (pending_colors_.GetGeneration() != color_manager.GetGeneration()) {
+      pending_colors_ = color_manager;
+    }
+
+    pending_cursor_ = cursor;
+    is_cursor_visible_ = cursor_visible;
+
+    was_pending = is_frame_pending_;
+    is_frame_pending_ = true;
+
+    if (was_pending && is_stalled_) {
+      ++frame_stats_.dropped;
+      was_pending = false;
+    }
+  }
+
+  frame_ready_.notify_one();
+  return was_pending;
+}
+
+void curs::internal::RenderThread::Invalidate() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  is_invalidate_pending_ = true;
+}
+
+void curs::internal::RenderThread::SetCapabilities(const Capabilities& capabilities) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capabilities_ = capabilities;
+}
+
+void curs::internal::RenderThread::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  frame_done_.wait(lock, [this] { return !is_frame_pending_ && !is_rendering_; });
+}
+
+curs::FrameStats curs::internal::RenderThread::GetFrameStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frame_stats_;
+}
+
+void curs::internal::RenderThread::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for (;;) {
+    frame_ready_.wait(lock, [this] { return is_frame_pending_ || is_stopping_; });
+
+    // Stop only once the last frame is written.
+    if (!is_frame_pending_) {
+      break;
+    }
+
+    // Take the pending changes; the lock is held for copying only.
+    grid_.CopyChanges(pending_grid_);
+    pending_grid_.ClearDamage();
+
+    if (color_manager_.GetGeneration() != pending_colors_.GetGeneration()) {
+      color_manager_ = pending_colors_;
+    }
+
+    Point cursor = pending_cursor_;
+    bool cursor_visible = is_cursor_visible_;
+    bool invalidate = is_invalidate_pending_;
+    Capabilities capabilities = capabilities_;
+
+    is_invalidate_pending_ = false;
+    is_frame_pending_ = false;
+    is_rendering_ = true;
+
+    lock.unlock();
+
+    if (invalidate) {
+      renderer_.Invalidate();
+    }
+
+    renderer_.SetCapabilities(capabilities);
+
+    renderer_.Render(grid_, color_manager_, cursor, cursor_visible);
+    grid_.ClearDamage();
+
+    const std::vector<FrameSegment>& segments = renderer_.GetFrameSegments();
+    const std::size_t frame_size = renderer_.GetFrameSize();
+    unsigned long long syscalls = terminal_.GetSyscallCount();
+    unsigned long long stalls = terminal_.GetStallCount();
+
+    // Publishes made while the terminal is congested are merged into the
+    // pending grid, which is rendered once the frame is written.
+    if (frame_size > 0 && !terminal_.WriteFrame(segments.data(), segments.size())) {
+      lock.lock();
+      is_stalled_ = true;
+      lock.unlock();
+
+      terminal_.DrainOutput();
+    }
+
+    syscalls = terminal_.GetSyscallCount() - syscalls;
+    stalls = terminal_.GetStallCount() - stalls;
+
+    lock.lock();
+
+    is_stalled_ = false;
+    frame_stats_.stalls += stalls;
+    frame_stats_.last_frame_bytes = static_cast<unsigned long>(frame_size);
+    frame_stats_.last_frame_syscalls = static_cast<unsigned long>(syscalls);
+    frame_stats_.bytes += frame_size;
+    frame_stats_.syscalls += syscalls;
+
+    if (syscalls > 0) {
+      ++frame_stats_.frames;
+    }
+
+    is_rendering_ = false;
+    frame_done_.notify_all();
+  }
+}
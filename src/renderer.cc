@@ -0,0 +1,712 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wcurses/renderer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "wcurses/cell_grid.h"
+#include "wcurses/color_manager.h"
+#include "wcurses/number_format.h"
+#include "wcurses/point.h"
+#include "wcurses/structures.h"
+#include "wcurses/unicode.h"
+
+constexpr curs::internal::ColorManager::PairIndex curs::internal::Renderer::kUnknownPair;
+constexpr curs::Attr curs::internal::Renderer::kUnknownAttributes;
+constexpr std::size_t curs::internal::Renderer::kMaxSegments;
+constexpr std::size_t curs::internal::Renderer::kReservedSegments;
+
+namespace {
+
+// Sequences that hide and show the cursor.
+constexpr char kHideCursor[] = "\033[?25l";
+constexpr char kShowCursor[] = "\033[?25h";
+
+// Resets the colors to the terminal's defaults.
+constexpr char kResetColors[] = "\033[0m";
+
+// Color codes of at least this length are referenced instead of copied;
+// shorter ones cost less to copy than a segment of their own.
+constexpr std::size_t kMinReferenceLength = 24;
+
+// SGR parameters that turn an attribute on and off. Bold and dim are
+// turned off together.
+struct AttributeCodes {
+  curs::Attr attribute;
+  const char* on;
+  const char* off;
+};
+
+constexpr AttributeCodes kAttributeCodes[] = {
+  {curs::Attr::kBold, "1", "22"},
+  {curs::Attr::kDim, "2", "22"},
+  {curs::Attr::kItalic, "3", "23"},
+  {curs::Attr::kUnderline, "4", "24"},
+  {curs::Attr::kBlink, "5", "25"},
+  {curs::Attr::kReverse, "7", "27"}
+};
+
+// Upper bound for the length of the parameters written by FormatAttributeChanges.
+constexpr std::size_t kAttributeChangesLength = 32;
+
+// Upper bound for the length of a cursor positioning sequence,
+// "\033[32767;32767H".
+constexpr std::size_t kCursorPositionLength = 14;
+
+// Frames up to this size reach the terminal in one read and are drawn at
+// once, the cursor only has to be hidden while bigger frames are drawn.
+constexpr std::size_t kHideCursorThreshold = 1024;
+
+// Number of decimal digits of a positive number.
+std::size_t GetDigitCount(int value) {
+  std::size_t count = 1;
+
+  for(; value >= 10; value /= 10) {
+    ++count;
+  }
+
+  return count;
+}
+
+// Writes the SGR parameters that change the attributes from into to,
+// separated by ';', and returns the end of the parameters.
+char* FormatAttributeChanges(curs::Attr from, curs::Attr to, char* out) {
+  const curs::Attr bold_dim = curs::Attr::kBold | curs::Attr::kDim;
+  curs::Attr off = from & ~to;
+  curs::Attr on = to & ~from;
+  char* begin = out;
+
+  auto add = [&](const char* parameter) {
+    if(out != begin) {
+      *out++ = ';';
+    }
+
+    while(*parameter != '\0') {
+      *out++ = *parameter++;
+    }
+  };
+
+  // Turning bold or dim off turns off both, the one that stays is turned on again.
+  if((off & bold_dim) != curs::Attr::kNormal) {
+    add("22");
+    on = on | (to & bold_dim);
+  }
+
+  for(const AttributeCodes& codes : kAttributeCodes) {
+    if((codes.attribute & bold_dim) == curs::Attr::kNormal &&
+       (off & codes.attribute) != curs::Attr::kNormal) {
+      add(codes.off);
+    }
+  }
+
+  for(const AttributeCodes& codes : kAttributeCodes) {
+    if((on & codes.attribute) != curs::Attr::kNormal) {
+      add(codes.on);
+    }
+  }
+
+  return out;
+}
+
+// Length of the parameters of "\033[<parameters>m", 0 for an empty code.
+std::size_t GetSgrParametersLength(const std::string& code) {
+  return code.empty() ? 0 : code.size() - 3;
+}
+
+// Length of "\033[<count><final>", where a count of 1 is left out.
+// A count of zero stands for no sequence at all.
+std::size_t GetSequenceLength(int count) {
+  if(count == 0) {
+    return 0;
+  }
+
+  return count == 1 ? 3 : 3 + GetDigitCount(count);
+}
+
+// Length of the sequence that AppendCursorPosition appends.
+std::size_t GetCursorPositionLength(short y, short x) {
+  if(x == 0) {
+    return y == 0 ? 3 : 3 + GetDigitCount(y + 1);
+  }
+
+  return 4 + GetDigitCount(y + 1) + GetDigitCount(x + 1);
+}
+
+// Length of a move by count cells with single-byte controls or with an
+// escape sequence, whichever is shorter: left with backspaces or
+// "\033[<n>D", or down after a carriage return with line feeds or "\033[<n>B".
+std::size_t GetShortMoveLength(int count) {
+  std::size_t sequence_length = GetSequenceLength(count);
+  return static_cast<std::size_t>(count) < sequence_length ? count : sequence_length;
+}
+
+} // namespace
+
+void curs::internal::Renderer::Render(const CellGrid& grid,
+                                      const ColorManager& color_manager,
+                                      const Point& cursor, bool cursor_visible) {
+  screen_buffer_.clear();
+  segments_.clear();
+  slice_begin_ = 0;
+  frame_size_ = 0;
+
+  if(!use_escape_sequences_) {
+    RenderFullFrame(grid, color_manager);
+    FinishFrame();
+    return;
+  }
+
+  const Size& size = grid.GetSize();
+
+  // The terminal keeps the overlapping area on resize, while the cells
+  // exposed by a bigger size are unknown and have to be painted.
+  if(front_.GetRows() != size.rows || front_.GetCols() != size.cols) {
+    front_.Resize(size, {' ', Attr::kNormal, kUnknownPair});
+
+    // Room for a full repaint without color changes. The buffer is only
+    // cleared between frames, so its capacity is reused.
+    screen_buffer_.reserve(static_cast<std::size_t>(size.rows) *
+                           (size.cols + kCursorPositionLength));
+  }
+
+  // New colors make the previous frame useless for comparison.
+  if(color_generation_ != color_manager.GetGeneration()) {
+    color_generation_ = color_manager.GetGeneration();
+    Invalidate();
+  }
+
+  bool was_color_active = is_color_active_;
+  is_color_active_ = color_manager.HasColorOutput();
+
+  // Otherwise the terminal keeps drawing with the colors set last.
+  if(was_color_active && !is_color_active_) {
+    screen_buffer_ += kResetColors;
+    current_attributes_ = Attr::kNormal;
+  }
+
+  // Repeat the scrolls on the terminal: the rows that only moved are
+  // then already in place and are not repainted.
+  if(is_front_valid_) {
+    for(const ScrollOp& scroll : grid.GetScrolls()) {
+      AppendScroll(scroll, size.rows);
+
+      // The rows scrolled in show whatever the terminal fills them with.
+      front_.Scroll(scroll.top, scroll.bottom, scroll.count, {' ', Attr::kNormal, kUnknownPair});
+    }
+  }
+
+  // Unless nothing was written and nothing has to be repainted.
+  if(!is_front_valid_ || grid.IsDirty()) {
+    RenderCells(grid, color_manager);
+  }
+
+  // The cursor is still where the previous frame left it.
+  if(screen_buffer_.empty() && segments_.empty() &&
+     cursor.y == cursor_y_ && cursor.x == cursor_x_) {
+    return;
+  }
+
+  AppendCursorMove(cursor.y, cursor.x);
+  FinishFrame();
+
+  // A visible cursor would flicker across the screen while a frame that the
+  // terminal reads in several parts is drawn.
+  if(cursor_visible && frame_size_ > kHideCursorThreshold) {
+    segments_.insert(segments_.begin(), FrameSegment{kHideCursor, sizeof(kHideCursor) - 1});
+    segments_.push_back(FrameSegment{kShowCursor, sizeof(kShowCursor) - 1});
+    frame_size_ += sizeof(kHideCursor) - 1 + sizeof(kShowCursor) - 1;
+  }
+}
+
+void curs::internal::Renderer::RenderCells(const CellGrid& grid,
+                                           const ColorManager& color_manager) {
+  const Size& size = grid.GetSize();
+
+  for(short y = 0; y < size.rows; ++y) {
+    // With an invalid front every row differs, whatever the damage says.
+    DirtySpan span = is_front_valid_ ? grid.GetDirtySpan(y) : DirtySpan{0, size.cols};
+
+    if(span.IsClean()) {
+      continue;
+    }
+
+    const ChType* back_row = grid.Row(y);
+    ChType* front_row = front_.Row(y);
+
+    short x = span.begin;
+
+    while(x < span.end) {
+      // Skip the cells the terminal already shows.
+      if(back_row[x] == front_row[x]) {
+        ++x;
+        continue;
+      }
+
+      short changed_end = x + 1;
+      while(changed_end < span.end && back_row[changed_end] != front_row[changed_end]) {
+        ++changed_end;
+      }
+
+      // The right half of a wide character is drawn with its left half.
+      if(x > 0 && back_row[x].symbol == kWideContinuation) {
+        --x;
+      }
+
+      // Emit the whole run of changed cells.
+      while(x < changed_end) {
+        // An erase sequence leaves the cursor at the start of the cells.
+        if(cursor_y_ != y || cursor_x_ != x) {
+          AppendCursorMove(y, x);
+        }
+
+        AppendStyle(color_manager, back_row[x]);
+
+        short run_end = AppendEqualCells(back_row, y, x, changed_end - x);
+
+        if(run_end != x) {
+          x = run_end;
+          continue;
+        }
+
+        AppendSymbol(grid.GetGraphemes(), back_row[x].symbol);
+        front_row[x] = back_row[x];
+        ++x;
+
+        if(x < size.cols && back_row[x].symbol == kWideContinuation) {
+          front_row[x] = back_row[x];
+          ++x;
+        }
+
+        // After the last column the cursor waits there to wrap.
+        cursor_x_ = x;
+      }
+    }
+  }
+
+  // The front grid is only compared, never rendered, its damage is of no use.
+  if(front_.IsDirty()) {
+    front_.ClearDamage();
+  }
+
+  is_front_valid_ = true;
+}
+
+void curs::internal::Renderer::Invalidate() {
+  front_.Fill({' ', Attr::kNormal, kUnknownPair});
+  current_pair_ = kUnknownPair;
+  current_attributes_ = kUnknownAttributes;
+  cursor_y_ = -1;
+  cursor_x_ = -1;
+  is_front_valid_ = false;
+}
+
+void curs::internal::Renderer::SetEscapeSequences(bool enable) {
+  if(use_escape_sequences_ == enable) {
+    return;
+  }
+
+  use_escape_sequences_ = enable;
+  Invalidate();
+}
+
+void curs::internal::Renderer::RenderFullFrame(const CellGrid& grid,
+                                               const ColorManager& color_manager) {
+  const Size& size = grid.GetSize();
+  bool is_color_active = color_manager.HasColorOutput();
+
+  // Every cell produces one character, plus a newline per row; characters
+  // that are not ASCII take more bytes and may grow the buffer.
+  screen_buffer_.reserve(static_cast<size_t>(size.rows) * (size.cols + 1));
+
+  // The terminal state is unknown at the beginning of a full frame.
+  current_pair_ = kUnknownPair;
+
+  for(short y = 0; y < size.rows; ++y) {
+    const ChType* row = grid.Row(y);
+
+    for(short x = 0; x < size.cols; ++x) {
+      if(is_color_active) {
+        AppendColor(color_manager, row[x].color_pair);
+      }
+
+      // The right half of a wide character was drawn with its left half.
+      if(row[x].symbol != kWideContinuation) {
+        AppendSymbol(grid.GetGraphemes(), row[x].symbol);
+      }
+    }
+    // Add a newline character after each line except the last one
+    if (y < size.rows - 1) {
+      screen_buffer_ += '\n';
+    }
+  }
+}
+
+void curs::internal::Renderer::AppendCursorMove(short y, short x) {
+  enum class Method { kPosition, kRelative, kReturn };
+
+  Method method = Method::kPosition;
+  std::size_t length = GetCursorPositionLength(y, x);
+
+  if(cursor_y_ >= 0) {
+    const int delta_y = y - cursor_y_;
+    const std::size_t vertical_length = GetSequenceLength(delta_y < 0 ? -delta_y : delta_y);
+
+    // Relative moves start from the current column, which is not known
+    // exactly while a wrap is pending.
+    if(cursor_x_ < front_.GetCols()) {
+      std::size_t relative_length = vertical_length +
+          (x >= cursor_x_ ? GetForwardLength(y, cursor_x_, x) : GetShortMoveLength(cursor_x_ - x));
+
+      if(relative_length < length) {
+        method = Method::kRelative;
+        length = relative_length;
+      }
+    }
+
+    // "\r", then down with line feeds if needed, then right from the first column.
+    std::size_t return_length = 1 + (delta_y > 0 ? GetShortMoveLength(delta_y) : vertical_length) +
+                                GetForwardLength(y, 0, x);
+
+    if(return_length < length) {
+      method = Method::kReturn;
+    }
+  }
+
+  const int delta_y = y - cursor_y_;
+
+  switch(method) {
+    case Method::kPosition:
+      AppendCursorPosition(y, x);
+      break;
+
+    case Method::kRelative:
+      if(delta_y != 0) {
+        AppendSequence(delta_y < 0 ? -delta_y : delta_y, delta_y < 0 ? 'A' : 'B');
+      }
+
+      if(x >= cursor_x_) {
+        AppendForward(y, cursor_x_, x);
+      } else if(static_cast<std::size_t>(cursor_x_ - x) < GetSequenceLength(cursor_x_ - x)) {
+        screen_buffer_.append(cursor_x_ - x, '\b');
+      } else {
+        AppendSequence(cursor_x_ - x, 'D');
+      }
+      break;
+
+    case Method::kReturn:
+      screen_buffer_ += '\r';
+
+      if(delta_y > 0 && static_cast<std::size_t>(delta_y) < GetSequenceLength(delta_y)) {
+        screen_buffer_.append(delta_y, '\n');
+      } else if(delta_y != 0) {
+        AppendSequence(delta_y < 0 ? -delta_y : delta_y, delta_y < 0 ? 'A' : 'B');
+      }
+
+      AppendForward(y, 0, x);
+      break;
+  }
+
+  cursor_y_ = y;
+  cursor_x_ = x;
+}
+
+void curs::internal::Renderer::AppendCursorPosition(short y, short x) {
+  // Format: "\033[<row>;<column>H", both counted from 1. Values of 1 are
+  // left out from the end.
+  screen_buffer_ += "\033[";
+
+  if(y != 0 || x != 0) {
+    AppendNumber(y + 1);
+  }
+
+  if(x != 0) {
+    screen_buffer_ += ';';
+    AppendNumber(x + 1);
+  }
+
+  screen_buffer_ += 'H';
+}
+
+short curs::internal::Renderer::AppendEqualCells(const ChType* back_row, short y,
+                                                  short x, short changed) {
+  if(!capabilities_.repeat && !capabilities_.erase) {
+    return x;
+  }
+
+  // Writing cells the terminal already shows changes nothing, so the run
+  // may go on past the changed cells.
+  const short cols = front_.GetCols();
+  const ChType& cell = back_row[x];
+  short end = x + 1;
+
+  while(end < cols && back_row[end] == cell) {
+    ++end;
+  }
+
+  const short count = end - x;
+  const std::size_t literal_length = changed < count ? changed : count;
+  ChType* front_row = front_.Row(y);
+
+  // Erased cells take the background color, but no attributes.
+  if(cell.symbol == ' ' && cell.attributes == Attr::kNormal && capabilities_.erase) {
+    // "\033[K" erases to the end of the line, "\033[<n>X" erases n cells.
+    // Both leave the cursor in place, so it has to skip the erased cells
+    // if more changes follow.
+    if(end == cols && literal_length > 3) {
+      screen_buffer_ += "\033[K";
+    } else if(GetSequenceLength(count) * (changed > count ? 2 : 1) < literal_length) {
+      AppendSequence(count, 'X');
+    } else {
+      return x;
+    }
+  } else if(capabilities_.repeat && cell.symbol < 0x80 && count > 1 &&
+            1 + GetSequenceLength(count - 1) < literal_length) {
+    // The character once, then "\033[<n>b" repeats it n more times.
+    screen_buffer_ += static_cast<char>(cell.symbol);
+    AppendSequence(count - 1, 'b');
+    cursor_x_ = end;
+  } else {
+    return x;
+  }
+
+  std::fill(front_row + x, front_row + end, cell);
+  return end;
+}
+
+void curs::internal::Renderer::AppendSymbol(const GraphemeTable& graphemes, char32_t symbol) {
+  if(symbol < 0x80) {
+    screen_buffer_ += static_cast<char>(symbol);
+  } else if(symbol >= kFirstGrapheme) {
+    screen_buffer_ += graphemes.GetText(symbol);
+  } else {
+    char bytes[kMaxUtf8Length];
+    screen_buffer_.append(bytes, EncodeUtf8(symbol, bytes));
+  }
+}
+
+void curs::internal::Renderer::AppendSequence(int count, char final_byte) {
+  screen_buffer_ += "\033[";
+
+  if(count != 1) {
+    AppendNumber(count);
+  }
+
+  screen_buffer_ += final_byte;
+}
+
+void curs::internal::Renderer::AppendForward(short y, short from, short to) {
+  if(from == to) {
+    return;
+  }
+
+  if(IsRewritable(y, from, to)) {
+    const ChType* front_row = front_.Row(y);
+
+    for(short x = from; x < to; ++x) {
+      screen_buffer_ += static_cast<char>(front_row[x].symbol);
+    }
+  } else {
+    AppendSequence(to - from, 'C');
+  }
+}
+
+std::size_t curs::internal::Renderer::GetForwardLength(short y, short from, short to) const {
+  return IsRewritable(y, from, to) ? static_cast<std::size_t>(to - from)
+                                   : GetSequenceLength(to - from);
+}
+
+bool curs::internal::Renderer::IsRewritable(short y, short from, short to) const {
+  // Only worth it while the cells are shorter than the sequence.
+  if(from == to || static_cast<std::size_t>(to - from) >= GetSequenceLength(to - from)) {
+    return false;
+  }
+
+  const ChType* front_row = front_.Row(y);
+
+  // Only ASCII is rewritten, it takes one byte per cell.
+  for(short x = from; x < to; ++x) {
+    if(front_row[x].symbol >= 0x80 || front_row[x].color_pair == kUnknownPair ||
+       front_row[x].attributes != current_attributes_ ||
+       (is_color_active_ && front_row[x].color_pair != current_pair_)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void curs::internal::Renderer::AppendScroll(const ScrollOp& scroll, short rows) {
+  // A region smaller than the screen is set with "\033[<top>;<bottom>r"
+  // for the scroll and reset with "\033[r" afterwards.
+  bool is_region = scroll.top != 0 || scroll.bottom != rows - 1;
+
+  // Terminals ignore a region of a single row and would scroll the whole
+  // screen instead. The row is repainted, as the front marks it unknown.
+  if(is_region && scroll.top == scroll.bottom) {
+    return;
+  }
+
+  if(is_region) {
+    screen_buffer_ += "\033[";
+    AppendNumber(scroll.top + 1);
+    screen_buffer_ += ';';
+    AppendNumber(scroll.bottom + 1);
+    screen_buffer_ += 'r';
+  }
+
+  // "\033[<n>S" scrolls up, "\033[<n>T" scrolls down.
+  screen_buffer_ += "\033[";
+  AppendNumber(scroll.count > 0 ? scroll.count : -scroll.count);
+  screen_buffer_ += scroll.count > 0 ? 'S' : 'T';
+
+  if(is_region) {
+    screen_buffer_ += "\033[r";
+
+    // Setting the region moves the cursor to the upper left corner.
+    cursor_y_ = 0;
+    cursor_x_ = 0;
+  }
+}
+
+void curs::internal::Renderer::AppendColor(const ColorManager& color_manager,
+                                           ColorManager::PairIndex pair) {
+  if(pair == current_pair_) {
+    return;
+  }
+
+  // Set both colors if nothing is known about the terminal state,
+  // otherwise only the changed parameters.
+  const std::string& color_code = current_pair_ == kUnknownPair
+      ? color_manager.MakeColorCode(pair)
+      : color_manager.MakeColorCode(current_pair_, pair);
+
+  if(color_code.size() >= kMinReferenceLength) {
+    AppendReference(color_code.data(), color_code.size());
+  } else {
+    screen_buffer_ += color_code;
+  }
+
+  current_pair_ = pair;
+}
+
+void curs::internal::Renderer::AppendStyle(const ColorManager& color_manager,
+                                           const ChType& cell) {
+  if(cell.attributes == current_attributes_) {
+    if(is_color_active_) {
+      AppendColor(color_manager, cell.color_pair);
+    }
+
+    return;
+  }
+
+  // The parameters of the colors follow those of the attributes in one
+  // sequence. A reset ("0") turns every attribute off and sets the default
+  // colors, so all colors have to be set again after it.
+  static const std::string kNoColorCode;
+  const std::string& reset_color_code = is_color_active_
+      ? color_manager.MakeColorCode(cell.color_pair)
+      : kNoColorCode;
+
+  char reset[kAttributeChangesLength] = {'0'};
+  char* reset_end = reset + 1;
+
+  if(cell.attributes != Attr::kNormal) {
+    *reset_end++ = ';';
+    reset_end = FormatAttributeChanges(Attr::kNormal, cell.attributes, reset_end);
+  }
+
+  const char* parameters = reset;
+  const char* parameters_end = reset_end;
+  const std::string* color_code = &reset_color_code;
+
+  char changes[kAttributeChangesLength];
+
+  if(current_attributes_ != kUnknownAttributes) {
+    char* changes_end = FormatAttributeChanges(current_attributes_, cell.attributes, changes);
+    const std::string& changed_color_code =
+        !is_color_active_ || cell.color_pair == current_pair_ ? kNoColorCode
+        : current_pair_ == kUnknownPair ? color_manager.MakeColorCode(cell.color_pair)
+        : color_manager.MakeColorCode(current_pair_, cell.color_pair);
+
+    if(static_cast<std::size_t>(changes_end - changes) + GetSgrParametersLength(changed_color_code) <=
+       static_cast<std::size_t>(reset_end - reset) + GetSgrParametersLength(reset_color_code)) {
+      parameters = changes;
+      parameters_end = changes_end;
+      color_code = &changed_color_code;
+    }
+  }
+
+  screen_buffer_ += "\033[";
+  screen_buffer_.append(parameters, parameters_end - parameters);
+
+  if(!color_code->empty()) {
+    screen_buffer_ += ';';
+    screen_buffer_.append(*color_code, 2, color_code->size() - 3);
+  }
+
+  screen_buffer_ += 'm';
+
+  current_attributes_ = cell.attributes;
+
+  if(is_color_active_) {
+    current_pair_ = cell.color_pair;
+  }
+}
+
+void curs::internal::Renderer::AppendReference(const char* data, std::size_t size) {
+  if(segments_.size() + kReservedSegments > kMaxSegments) {
+    screen_buffer_.append(data, size);
+    return;
+  }
+
+  CloseSlice();
+  segments_.push_back(FrameSegment{data, size});
+}
+
+void curs::internal::Renderer::CloseSlice() {
+  // Slices are recorded without an address, screen_buffer_ may still move.
+  if(screen_buffer_.size() > slice_begin_) {
+    segments_.push_back(FrameSegment{nullptr, screen_buffer_.size() - slice_begin_});
+    slice_begin_ = screen_buffer_.size();
+  }
+}
+
+void curs::internal::Renderer::FinishFrame() {
+  CloseSlice();
+
+  // The slices follow each other in screen_buffer_.
+  const char* slice = screen_buffer_.data();
+
+  for(FrameSegment& segment : segments_) {
+    if(segment.data == nullptr) {
+      segment.data = slice;
+      slice += segment.size;
+    }
+
+    frame_size_ += segment.size;
+  }
+}
+
+void curs::internal::Renderer::AppendNumber(int value) {
+  char digits[kMaxIntegerLength];
+  char* digits_end = digits + kMaxIntegerLength;
+  char* first = FormatInteger(value, digits_end);
+
+  screen_buffer_.append(first, digits_end - first);
+}
@@ -25,6 +25,7 @@
 
 curs::internal::Terminal::Terminal() {
   cursor_visibility_ = true;
+  is_virtual_mode_enabled = false;
 
   // Retrieves the terminal handle for standard output
   terminal_handle_ = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -35,6 +36,10 @@ curs::internal::Terminal::Terminal() {
   // Retrieves the current console mode settings.
   GetConsoleMode(terminal_handle_, &terminal_mode_);
 
+  // Frames are UTF-8 encoded.
+  output_code_page_ = GetConsoleOutputCP();
+  SetConsoleOutputCP(CP_UTF8);
+
   // Enables virtual processing mode for advanced terminal features.
   EnableVirtualMode();
 }
@@ -43,15 +48,41 @@ curs::internal::Terminal& curs::internal::Terminal::operator<<(
   const std::string& str) {
   // Outputs the provided string to the console.
   WriteConsoleA(terminal_handle_, str.c_str(), static_cast<DWORD>(str.length()), NULL, NULL);
+  ++syscall_count_;
   return *this;
 }
 
 curs::internal::Terminal& curs::internal::Terminal::operator<<(char ch) {
   // Outputs the provided character to the console.
   WriteConsoleA(terminal_handle_, &ch, 1, NULL, NULL);
+  ++syscall_count_;
   return *this;
 }
 
+bool curs::internal::Terminal::WriteFrame(const FrameSegment* segments, std::size_t count) {
+  const char* data = count == 1 ? segments[0].data : nullptr;
+  std::size_t length = count == 1 ? segments[0].size : 0;
+
+  // The console has no vectored write.
+  if(count > 1) {
+    frame_output_.clear();
+
+    for(std::size_t i = 0; i < count; ++i) {
+      frame_output_.append(segments[i].data, segments[i].size);
+    }
+
+    data = frame_output_.data();
+    length = frame_output_.size();
+  }
+
+  if(length > 0) {
+    WriteConsoleA(terminal_handle_, data, static_cast<DWORD>(length), NULL, NULL);
+    ++syscall_count_;
+  }
+
+  return true;
+}
+
 void curs::internal::Terminal::ClearScreen() {
   // Clears the terminal screen by invoking the "cls" command.
   system("cls");
@@ -66,6 +97,7 @@ void curs::internal::Terminal::MoveCursor(const Point& cursor) {
   // Moves the cursor to the specified coordinates represented by the Point object.
   COORD new_cursor {cursor.x, cursor.y};
   SetConsoleCursorPosition(terminal_handle_, new_cursor);
+  ++syscall_count_;
 }
 
 void curs::internal::Terminal::MoveCursor(short y, short x) {
@@ -174,6 +206,7 @@ void curs::internal::Terminal::SetCursorVisible(bool visible) {
 
   // Apply the cursor settings.
   SetConsoleCursorInfo(terminal_handle_, &cursor_info);
+  ++syscall_count_;
 }
 
 void curs::internal::Terminal::RestoreTerminalMode() {
@@ -181,6 +214,8 @@ void curs::internal::Terminal::RestoreTerminalMode() {
   if(SetConsoleMode(terminal_handle_, terminal_mode_)) {
     is_virtual_mode_enabled = false;
   }
+
+  SetConsoleOutputCP(output_code_page_);
 }
 
 void curs::internal::Terminal::EnableVirtualMode() {
@@ -0,0 +1,474 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _WIN32
+
+#include "wcurses/terminal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "wcurses/number_format.h"
+#include "wcurses/point.h"
+#include "wcurses/structures.h"
+#include "wcurses/virtual_terminal.h"
+
+namespace {
+
+// Set by the SIGWINCH handler, read and reset by Terminal::WasResized.
+volatile sig_atomic_t was_resized = 0;
+
+void HandleResize(int) {
+  was_resized = 1;
+}
+
+// Fallback when neither the terminal nor the environment report a size.
+constexpr short kDefaultRows = 24;
+constexpr short kDefaultCols = 80;
+
+// Reads a positive size from an environment variable, or returns fallback.
+short GetEnvironmentSize(const char* name, short fallback) {
+  const char* value = std::getenv(name);
+  int size = value ? std::atoi(value) : 0;
+
+  return size > 0 && size <= 0x7fff ? static_cast<short>(size) : fallback;
+}
+
+} // namespace
+
+constexpr std::size_t curs::internal::Terminal::kMaxVectors;
+
+curs::internal::Terminal::Terminal() {
+  cursor_visibility_ = true;
+  is_raw_mode_enabled_ = false;
+  is_active_ = true;
+
+  output_fd_ = STDOUT_FILENO;
+  input_fd_ = STDIN_FILENO;
+
+  // Read keys one at a time, without echo and without translation of
+  // carriage returns. Signals (Ctrl+C) and output processing stay enabled.
+  if(tcgetattr(input_fd_, &terminal_mode_) == 0) {
+    termios raw_mode = terminal_mode_;
+
+    raw_mode.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+    raw_mode.c_iflag &= ~(ICRNL | IXON);
+    raw_mode.c_cc[VMIN] = 1;
+    raw_mode.c_cc[VTIME] = 0;
+
+    is_raw_mode_enabled_ = tcsetattr(input_fd_, TCSAFLUSH, &raw_mode) == 0;
+  }
+
+  // Track size changes of the terminal window.
+  struct sigaction action = {};
+  action.sa_handler = HandleResize;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGWINCH, &action, &resize_action_);
+  was_resized = 0;
+
+  // A slow terminal must not block the program: frames it cannot take yet
+  // are kept as pending output (see WriteFrame). The flags of the standard
+  // output are shared with the shell and the program's own output, so the
+  // terminal is opened again for a non-blocking description of its own.
+  is_output_owned_ = false;
+
+  if(isatty(STDOUT_FILENO)) {
+    const char* name = ttyname(STDOUT_FILENO);
+    int fd = name ? open(name, O_WRONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC) : -1;
+
+    if(fd != -1) {
+      output_fd_ = fd;
+      is_output_owned_ = true;
+    }
+  }
+
+  // Switch to the alternate screen, which keeps the shell's contents intact.
+  *this << "\033[?1049h";
+}
+
+curs::internal::Terminal::Terminal(Size headless_size) {
+  cursor_visibility_ = true;
+  is_raw_mode_enabled_ = false;
+  is_active_ = false; // Nothing to restore.
+
+  output_fd_ = -1;
+  input_fd_ = -1;
+  is_output_owned_ = false;
+
+  if(headless_size.rows <= 0 || headless_size.cols <= 0) {
+    headless_size = {kDefaultRows, kDefaultCols};
+  }
+
+  virtual_terminal_.reset(new VirtualTerminal(headless_size));
+}
+
+curs::internal::Terminal::~Terminal() {
+  RestoreTerminalMode();
+}
+
+curs::internal::Terminal& curs::internal::Terminal::operator<<(
+  const std::string& str) {
+  Write(str.data(), str.size());
+  return *this;
+}
+
+curs::internal::Terminal& curs::internal::Terminal::operator<<(char ch) {
+  Write(&ch, 1);
+  return *this;
+}
+
+void curs::internal::Terminal::Write(const char* data, std::size_t length) {
+  if(virtual_terminal_) {
+    virtual_terminal_->Write(data, length);
+    ++syscall_count_;
+    return;
+  }
+
+  // Keep the order of the output.
+  DrainOutput();
+
+  while(length > 0) {
+    std::size_t written = WriteSome(data, length);
+
+    data += written;
+    length -= written;
+
+    if(length > 0) {
+      // Give up on errors other than a full output buffer.
+      if(written == 0 && IsOutputGone()) {
+        return;
+      }
+
+      WaitWritable(-1);
+    }
+  }
+}
+
+bool curs::internal::Terminal::WriteFrame(const FrameSegment* segments, std::size_t count) {
+  if(virtual_terminal_) {
+    for(std::size_t i = 0; i < count; ++i) {
+      virtual_terminal_->Write(segments[i].data, segments[i].size);
+    }
+
+    // As many as the vectored writes to a device would be.
+    syscall_count_ += (count + kMaxVectors - 1) / kMaxVectors;
+    return true;
+  }
+
+  // Behind the pending output, which keeps its own copy.
+  if(HasPendingOutput()) {
+    for(std::size_t i = 0; i < count; ++i) {
+      pending_output_.append(segments[i].data, segments[i].size);
+    }
+
+    return SendPendingOutput();
+  }
+
+  std::size_t written = WriteSome(segments, count);
+
+  // Skip what was written, only the rest is copied.
+  for(; count > 0 && written >= segments->size; ++segments, --count) {
+    written -= segments->size;
+  }
+
+  if(count == 0 || IsOutputGone()) {
+    return true;
+  }
+
+  // A blocking output (not a terminal) was interrupted: finish the frame.
+  if(!is_output_owned_) {
+    Write(segments->data + written, segments->size - written);
+
+    for(++segments, --count; count > 0; ++segments, --count) {
+      Write(segments->data, segments->size);
+    }
+
+    return true;
+  }
+
+  pending_output_.assign(segments->data + written, segments->size - written);
+  pending_offset_ = 0;
+
+  for(++segments, --count; count > 0; ++segments, --count) {
+    pending_output_.append(segments->data, segments->size);
+  }
+
+  return false;
+}
+
+bool curs::internal::Terminal::SendPendingOutput() {
+  if(!HasPendingOutput()) {
+    return true;
+  }
+
+  pending_offset_ += WriteSome(pending_output_.data() + pending_offset_,
+                               pending_output_.size() - pending_offset_);
+
+  if(HasPendingOutput() && !IsOutputGone()) {
+    return false;
+  }
+
+  DiscardPendingOutput();
+  return true;
+}
+
+void curs::internal::Terminal::DrainOutput() {
+  while(!SendPendingOutput()) {
+    WaitWritable(-1);
+  }
+}
+
+bool curs::internal::Terminal::WaitWritable(int timeout) {
+  if(virtual_terminal_) {
+    return true;
+  }
+
+  pollfd output = {output_fd_, POLLOUT, 0};
+
+  if(poll(&output, 1, timeout) <= 0) {
+    return false;
+  }
+
+  // A terminal that hung up takes nothing anymore; waiting for it would
+  // return at once, again and again.
+  if((output.revents & POLLOUT) == 0 && (output.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
+    DiscardPendingOutput();
+    return true;
+  }
+
+  return (output.revents & POLLOUT) != 0;
+}
+
+bool curs::internal::Terminal::IsOutputGone() const {
+  return write_error_ != 0 && write_error_ != EAGAIN && write_error_ != EWOULDBLOCK;
+}
+
+void curs::internal::Terminal::DiscardPendingOutput() {
+  // The capacity is kept for the next congestion.
+  pending_output_.clear();
+  pending_offset_ = 0;
+}
+
+std::size_t curs::internal::Terminal::WriteSome(const char* data, std::size_t length) {
+  std::size_t total = 0;
+
+  write_error_ = 0;
+
+  while(total < length) {
+    ssize_t written = ::write(output_fd_, data + total, length - total);
+    ++syscall_count_;
+
+    if(written < 0) {
+      // Interrupted by a signal (e.g. SIGWINCH) before anything was written.
+      if(errno == EINTR) {
+        continue;
+      }
+
+      if(errno == EAGAIN || errno == EWOULDBLOCK) {
+        ++stall_count_;
+      }
+
+      write_error_ = errno;
+      break;
+    }
+
+    total += static_cast<std::size_t>(written);
+  }
+
+  return total;
+}
+
+std::size_t curs::internal::Terminal::WriteSome(const FrameSegment* segments,
+                                               std::size_t count) {
+  iovec vectors[kMaxVectors];
+  std::size_t total = 0;
+
+  write_error_ = 0;
+
+  while(count > 0) {
+    std::size_t vector_count = count < kMaxVectors ? count : kMaxVectors;
+    std::size_t length = 0;
+
+    for(std::size_t i = 0; i < vector_count; ++i) {
+      vectors[i].iov_base = const_cast<char*>(segments[i].data);
+      vectors[i].iov_len = segments[i].size;
+      length += segments[i].size;
+    }
+
+    ssize_t written = ::writev(output_fd_, vectors, static_cast<int>(vector_count));
+    ++syscall_count_;
+
+    if(written < 0) {
+      // Interrupted by a signal (e.g. SIGWINCH) before anything was written.
+      if(errno == EINTR) {
+        continue;
+      }
+
+      if(errno == EAGAIN || errno == EWOULDBLOCK) {
+        ++stall_count_;
+      }
+
+      write_error_ = errno;
+      break;
+    }
+
+    total += static_cast<std::size_t>(written);
+
+    // The rest of a partial write is left to the caller.
+    if(static_cast<std::size_t>(written) < length) {
+      break;
+    }
+
+    segments += vector_count;
+    count -= vector_count;
+  }
+
+  return total;
+}
+
+void curs::internal::Terminal::ClearScreen() {
+  // Erase the whole screen and move the cursor to the upper left corner.
+  *this << "\033[2J\033[H";
+}
+
+void curs::internal::Terminal::ResetCursor() {
+  // Moves the cursor to the top-left corner (0, 0) of the terminal.
+  MoveCursor(0, 0);
+}
+
+void curs::internal::Terminal::MoveCursor(const Point& cursor) {
+  MoveCursor(cursor.y, cursor.x);
+}
+
+void curs::internal::Terminal::MoveCursor(short y, short x) {
+  // Format: "\033[<row>;<column>H", both counted from 1.
+  char sequence[2 * kMaxIntegerLength + 4];
+  char* end = sequence + sizeof(sequence);
+  char* first = end;
+
+  *--first = 'H';
+  first = FormatInteger(x + 1, first);
+  *--first = ';';
+  first = FormatInteger(y + 1, first);
+  *--first = '[';
+  *--first = '\033';
+
+  Write(first, end - first);
+}
+
+void curs::internal::Terminal::SetTitle(const std::string& title) {
+  // Operating system command 0 sets the icon name and the window title.
+  *this << "\033]0;" << title << '\007';
+}
+
+void curs::internal::Terminal::SetCursorVisible(bool visible) {
+  *this << (visible ? "\033[?25h" : "\033[?25l");
+  cursor_visibility_ = visible;
+}
+
+void curs::internal::Terminal::RestoreTerminalMode() {
+  if(!is_active_) {
+    return;
+  }
+
+  // Leave the alternate screen, the shell's contents reappear.
+  *this << "\033[?1049l";
+
+  if(is_output_owned_) {
+    close(output_fd_);
+    output_fd_ = STDOUT_FILENO;
+    is_output_owned_ = false;
+  }
+
+  if(is_raw_mode_enabled_) {
+    tcsetattr(input_fd_, TCSAFLUSH, &terminal_mode_);
+    is_raw_mode_enabled_ = false;
+  }
+
+  sigaction(SIGWINCH, &resize_action_, nullptr);
+
+  is_active_ = false;
+}
+
+bool curs::internal::Terminal::WasResized() {
+  if(!was_resized) {
+    return false;
+  }
+
+  was_resized = 0;
+  return true;
+}
+
+curs::Point curs::internal::Terminal::GetSize() const {
+  if(virtual_terminal_) {
+    return {virtual_terminal_->GetSize().rows, virtual_terminal_->GetSize().cols};
+  }
+
+  winsize window_size = {};
+
+  if(ioctl(output_fd_, TIOCGWINSZ, &window_size) == 0 &&
+     window_size.ws_row > 0 && window_size.ws_col > 0) {
+    return {static_cast<short>(window_size.ws_row),
+            static_cast<short>(window_size.ws_col)};
+  }
+
+  // Not a terminal (e.g. redirected output): use the size of the environment.
+  return {GetEnvironmentSize("LINES", kDefaultRows),
+          GetEnvironmentSize("COLUMNS", kDefaultCols)};
+}
+
+curs::ColorDepth curs::internal::Terminal::GetColorDepth() const {
+  // The virtual terminal interprets every color sequence.
+  if(virtual_terminal_) {
+    return ColorDepth::kTrueColor;
+  }
+
+  const char* color_term = std::getenv("COLORTERM");
+
+  if(color_term && (std::strcmp(color_term, "truecolor") == 0 ||
+                    std::strcmp(color_term, "24bit") == 0)) {
+    return ColorDepth::kTrueColor;
+  }
+
+  const char* term = std::getenv("TERM");
+
+  if(!term || *term == '\0' || std::strcmp(term, "dumb") == 0) {
+    return ColorDepth::kMonochrome;
+  }
+
+  if(std::strstr(term, "direct")) {
+    return ColorDepth::kTrueColor;
+  }
+
+  if(std::strstr(term, "256color")) {
+    return ColorDepth::k256;
+  }
+
+  return ColorDepth::k16;
+}
+
+#endif // _WIN32
@@ -0,0 +1,257 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wcurses/unicode.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <string>
+
+constexpr std::size_t curs::internal::GraphemeTable::kMaxEntries;
+
+namespace {
+
+struct CodePointRange {
+  char32_t first;
+  char32_t last;
+};
+
+// Combining marks, joiners and variation selectors of the common scripts,
+// which terminals draw over the character before them. Sorted.
+constexpr CodePointRange kZeroWidthRanges[] = {
+  {0x0300, 0x036f}, {0x0483, 0x0489}, {0x0591, 0x05bd}, {0x05bf, 0x05bf},
+  {0x05c1, 0x05c2}, {0x05c4, 0x05c5}, {0x05c7, 0x05c7}, {0x0610, 0x061a},
+  {0x064b, 0x065f}, {0x0670, 0x0670}, {0x06d6, 0x06dc}, {0x06df, 0x06e4},
+  {0x06e7, 0x06e8}, {0x06ea, 0x06ed}, {0x0711, 0x0711}, {0x0730, 0x074a},
+  {0x07a6, 0x07b0}, {0x0900, 0x0902}, {0x093a, 0x093a}, {0x093c, 0x093c},
+  {0x0941, 0x0948}, {0x094d, 0x094d}, {0x0951, 0x0957}, {0x0962, 0x0963},
+  {0x0981, 0x0981}, {0x09bc, 0x09bc}, {0x09c1, 0x09c4}, {0x09cd, 0x09cd},
+  {0x0e31, 0x0e31}, {0x0e34, 0x0e3a}, {0x0e47, 0x0e4e}, {0x1160, 0x11ff},
+  {0x1ab0, 0x1aff}, {0x1dc0, 0x1dff}, {0x200b, 0x200f}, {0x202a, 0x202e},
+  {0x2060, 0x2064}, {0x20d0, 0x20ff}, {0xfe00, 0xfe0f}, {0xfe20, 0xfe2f},
+  {0xfeff, 0xfeff}, {0x1f3fb, 0x1f3ff}, {0xe0020, 0xe007f}, {0xe0100, 0xe01ef}
+};
+
+// East Asian wide and fullwidth characters and emoji. Sorted.
+constexpr CodePointRange kWideRanges[] = {
+  {0x1100, 0x115f}, {0x231a, 0x231b}, {0x2329, 0x232a}, {0x23e9, 0x23ec},
+  {0x23f0, 0x23f0}, {0x23f3, 0x23f3}, {0x25fd, 0x25fe}, {0x2614, 0x2615},
+  {0x2648, 0x2653}, {0x267f, 0x267f}, {0x2693, 0x2693}, {0x26a1, 0x26a1},
+  {0x26aa, 0x26ab}, {0x26bd, 0x26be}, {0x26c4, 0x26c5}, {0x26ce, 0x26ce},
+  {0x26d4, 0x26d4}, {0x26ea, 0x26ea}, {0x26f2, 0x26f3}, {0x26f5, 0x26f5},
+  {0x26fa, 0x26fa}, {0x26fd, 0x26fd}, {0x2705, 0x2705}, {0x270a, 0x270b},
+  {0x2728, 0x2728}, {0x274c, 0x274c}, {0x274e, 0x274e}, {0x2753, 0x2755},
+  {0x2757, 0x2757}, {0x2795, 0x2797}, {0x27b0, 0x27b0}, {0x27bf, 0x27bf},
+  {0x2b1b, 0x2b1c}, {0x2b50, 0x2b50}, {0x2b55, 0x2b55}, {0x2e80, 0x303e},
+  {0x3041, 0x33ff}, {0x3400, 0x4dbf}, {0x4e00, 0x9fff}, {0xa000, 0xa4cf},
+  {0xa960, 0xa97f}, {0xac00, 0xd7a3}, {0xf900, 0xfaff}, {0xfe10, 0xfe19},
+  {0xfe30, 0xfe6f}, {0xff00, 0xff60}, {0xffe0, 0xffe6}, {0x16fe0, 0x16fe4},
+  {0x17000, 0x18aff}, {0x1b000, 0x1b2ff}, {0x1f004, 0x1f004}, {0x1f0cf, 0x1f0cf},
+  {0x1f18e, 0x1f18e}, {0x1f191, 0x1f19a}, {0x1f1e6, 0x1f1ff}, {0x1f200, 0x1f251},
+  {0x1f300, 0x1f3fa}, {0x1f400, 0x1f64f}, {0x1f680, 0x1f6ff}, {0x1f7e0, 0x1f7eb},
+  {0x1f90c, 0x1f9ff}, {0x1fa70, 0x1faff}, {0x20000, 0x2fffd}, {0x30000, 0x3fffd}
+};
+
+// Widths as stored in the table of the Basic Multilingual Plane; the
+// default of 0 stands for a width of 1.
+constexpr unsigned char kNarrowCode = 0;
+constexpr unsigned char kZeroWidthCode = 1;
+constexpr unsigned char kWideCode = 2;
+
+constexpr char32_t kPlaneSize = 0x10000;
+
+template <std::size_t N>
+bool IsInRanges(const CodePointRange (&ranges)[N], char32_t code_point) {
+  const CodePointRange* range = std::upper_bound(
+      std::begin(ranges), std::end(ranges), code_point,
+      [](char32_t value, const CodePointRange& range) { return value < range.first; });
+
+  return range != std::begin(ranges) && code_point <= (range - 1)->last;
+}
+
+// Returns the table with the width of every code point of the Basic
+// Multilingual Plane, two bits each. It is computed on first use.
+const std::array<unsigned char, kPlaneSize / 4>& GetWidthTable() {
+  static const std::array<unsigned char, kPlaneSize / 4> table = [] {
+    std::array<unsigned char, kPlaneSize / 4> widths {};
+
+    auto set = [&](const CodePointRange& range, unsigned char code) {
+      for (char32_t code_point = range.first;
+           code_point <= range.last && code_point < kPlaneSize; ++code_point) {
+        widths[code_point / 4] |= static_cast<unsigned char>(code << (code_point % 4 * 2));
+      }
+    };
+
+    for (const CodePointRange& range : kZeroWidthRanges) {
+      set(range, kZeroWidthCode);
+    }
+
+    for (const CodePointRange& range : kWideRanges) {
+      set(range, kWideCode);
+    }
+
+    return widths;
+  }();
+
+  return table;
+}
+
+} // namespace
+
+int curs::internal::LookUpCharWidth(char32_t code_point) {
+  if (code_point < kPlaneSize) {
+    unsigned char code = (GetWidthTable()[code_point / 4] >> (code_point % 4 * 2)) & 3;
+    return code == kNarrowCode ? 1 : code == kWideCode ? 2 : 0;
+  }
+
+  if (IsInRanges(kZeroWidthRanges, code_point)) {
+    return 0;
+  }
+
+  return IsInRanges(kWideRanges, code_point) ? 2 : 1;
+}
+
+std::size_t curs::internal::DecodeUtf8(const char* data, std::size_t length,
+                                       char32_t* code_point) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  const unsigned char lead = bytes[0];
+
+  if (lead < 0x80) {
+    *code_point = lead;
+    return 1;
+  }
+
+  std::size_t sequence_length;
+  char32_t value;
+  char32_t minimum; // Smaller values are overlong encodings.
+
+  if ((lead & 0xe0) == 0xc0) {
+    sequence_length = 2;
+    value = lead & 0x1f;
+    minimum = 0x80;
+  } else if ((lead & 0xf0) == 0xe0) {
+    sequence_length = 3;
+    value = lead & 0x0f;
+    minimum = 0x800;
+  } else if ((lead & 0xf8) == 0xf0) {
+    sequence_length = 4;
+    value = lead & 0x07;
+    minimum = 0x10000;
+  } else {
+    *code_point = kReplacementCharacter;
+    return 1;
+  }
+
+  for (std::size_t i = 1; i < sequence_length; ++i) {
+    if (i == length) {
+      return 0;
+    }
+
+    if ((bytes[i] & 0xc0) != 0x80) {
+      *code_point = kReplacementCharacter;
+      return 1;
+    }
+
+    value = (value << 6) | (bytes[i] & 0x3f);
+  }
+
+  // Surrogates are not characters.
+  if (value < minimum || value > kMaxCodePoint || (value >= 0xd800 && value <= 0xdfff)) {
+    *code_point = kReplacementCharacter;
+    return 1;
+  }
+
+  *code_point = value;
+  return sequence_length;
+}
+
+std::size_t curs::internal::EncodeUtf8(char32_t code_point, char* out) {
+  if (code_point < 0x80) {
+    out[0] = static_cast<char>(code_point);
+    return 1;
+  }
+
+  if (code_point < 0x800) {
+    out[0] = static_cast<char>(0xc0 | (code_point >> 6));
+    out[1] = static_cast<char>(0x80 | (code_point & 0x3f));
+    return 2;
+  }
+
+  if (code_point < 0x10000) {
+    out[0] = static_cast<char>(0xe0 | (code_point >> 12));
+    out[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    out[2] = static_cast<char>(0x80 | (code_point & 0x3f));
+    return 3;
+  }
+
+  out[0] = static_cast<char>(0xf0 | (code_point >> 18));
+  out[1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+  out[2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+  out[3] = static_cast<char>(0x80 | (code_point & 0x3f));
+  return 4;
+}
+
+bool curs::internal::JoinsPrevious(const GraphemeTable& graphemes, char32_t previous,
+                                  char32_t code_point) {
+  static const char kZeroWidthJoiner[] = "\xe2\x80\x8d";
+
+  if (previous >= kFirstGrapheme) {
+    const std::string& text = graphemes.GetText(previous);
+    return text.size() > 3 && text.compare(text.size() - 3, 3, kZeroWidthJoiner) == 0;
+  }
+
+  return IsRegionalIndicator(previous) && IsRegionalIndicator(code_point);
+}
+
+char32_t curs::internal::GraphemeTable::Intern(const std::string& text) {
+  auto found = symbols_.find(text);
+
+  if (found != symbols_.end()) {
+    return found->second;
+  }
+
+  if (entries_.size() >= kMaxEntries) {
+    char32_t base = kReplacementCharacter;
+    DecodeUtf8(text.data(), text.size(), &base);
+    return base;
+  }
+
+  char32_t symbol = kFirstGrapheme + static_cast<char32_t>(entries_.size());
+  entries_.push_back(text);
+  symbols_.emplace(text, symbol);
+
+  return symbol;
+}
+
+char32_t curs::internal::GraphemeTable::Append(char32_t symbol, char32_t code_point) {
+  std::string text = symbol >= kFirstGrapheme ? GetText(symbol) : std::string();
+  char bytes[kMaxUtf8Length];
+
+  if (symbol < kFirstGrapheme) {
+    text.append(bytes, EncodeUtf8(symbol, bytes));
+  }
+
+  text.append(bytes, EncodeUtf8(code_point, bytes));
+  return Intern(text);
+}
+
+void curs::internal::GraphemeTable::CopyNewEntries(const GraphemeTable& source) {
+  for (std::size_t i = entries_.size(); i < source.entries_.size(); ++i) {
+    entries_.push_back(source.entries_[i]);
+    symbols_.emplace(source.entries_[i], kFirstGrapheme + static_cast<char32_t>(i));
+  }
+}
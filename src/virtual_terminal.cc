@@ -0,0 +1,753 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "wcurses/virtual_terminal.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "wcurses/point.h"
+#include "wcurses/structures.h"
+#include "wcurses/unicode.h"
+
+constexpr int curs::internal::VirtualTerminal::kDefaultColor;
+constexpr int curs::internal::VirtualTerminal::kRgbColor;
+constexpr int curs::internal::VirtualTerminal::kMaxParameters;
+
+namespace {
+
+constexpr unsigned char kEscape = 0x1b;
+constexpr char32_t kZeroWidthJoiner = 0x200d;
+
+// Distance between tab stops.
+constexpr short kTabWidth = 8;
+
+} // namespace
+
+curs::internal::VirtualTerminal::VirtualTerminal(Size size) : size_({0, 0}) {
+  Resize(size);
+}
+
+void curs::internal::VirtualTerminal::Write(const char* data, std::size_t length) {
+  ++stats_.writes;
+  stats_.bytes += length;
+
+  for (std::size_t i = 0; i < length; ++i) {
+    Consume(static_cast<unsigned char>(data[i]));
+  }
+}
+
+curs::internal::VirtualTerminal& curs::internal::VirtualTerminal::operator<<(
+    const std::string& str) {
+  Write(str.data(), str.size());
+  return *this;
+}
+
+void curs::internal::VirtualTerminal::Resize(Size size) {
+  size.rows = std::max<short>(size.rows, 1);
+  size.cols = std::max<short>(size.cols, 1);
+
+  std::vector<VirtualCell> cells(static_cast<std::size_t>(size.rows) * size.cols);
+
+  const short rows = std::min(size.rows, size_.rows);
+  const short cols = std::min(size.cols, size_.cols);
+
+  for (short y = 0; y < rows; ++y) {
+    std::copy_n(cells_.begin() + y * size_.cols, cols, cells.begin() + y * size.cols);
+  }
+
+  cells_ = std::move(cells);
+  size_ = size;
+
+  cursor_y_ = std::min<short>(cursor_y_, size_.rows - 1);
+  cursor_x_ = std::min<short>(cursor_x_, size_.cols - 1);
+  is_pending_wrap_ = false;
+
+  scroll_top_ = 0;
+  scroll_bottom_ = size_.rows - 1;
+}
+
+void curs::internal::VirtualTerminal::Reset() {
+  std::fill(cells_.begin(), cells_.end(), VirtualCell());
+
+  cursor_y_ = 0;
+  cursor_x_ = 0;
+  is_pending_wrap_ = false;
+  saved_y_ = 0;
+  saved_x_ = 0;
+  scroll_top_ = 0;
+  scroll_bottom_ = size_.rows - 1;
+  is_cursor_visible_ = true;
+
+  pen_ = VirtualCell();
+  last_symbol_ = U' ';
+  previous_code_point_ = 0;
+  is_flag_open_ = false;
+  state_ = State::kGround;
+  utf8_remaining_ = 0;
+}
+
+std::string curs::internal::VirtualTerminal::GetRowText(short y) const {
+  std::string text;
+  text.reserve(size_.cols);
+
+  for (short x = 0; x < size_.cols; ++x) {
+    char32_t symbol = At(y, x).symbol;
+
+    if (symbol == kWideContinuation) {
+      continue;
+    }
+
+    char bytes[kMaxUtf8Length];
+    text.append(bytes, EncodeUtf8(symbol, bytes));
+  }
+
+  return text;
+}
+
+void curs::internal::VirtualTerminal::Consume(unsigned char byte) {
+  switch (state_) {
+    case State::kGround:
+      if (byte == kEscape) {
+        state_ = State::kEscape;
+      } else if (byte < 0x20) {
+        ExecuteControl(byte);
+      } else if (byte != 0x7f) {
+        ConsumeText(byte);
+      }
+      return;
+
+    case State::kEscape:
+      ConsumeEscape(byte);
+      return;
+
+    case State::kEscapeIntermediate:
+      // Character set designations such as "ESC ( B" end with one more byte.
+      if (byte < 0x20 || byte > 0x2f) {
+        state_ = State::kGround;
+        ++stats_.sequences;
+      }
+      return;
+
+    case State::kCsi:
+      ConsumeCsi(byte);
+      return;
+
+    case State::kOsc:
+      // Ends with BEL or with ST ("ESC \").
+      if (byte == 0x07) {
+        state_ = State::kGround;
+        ++stats_.sequences;
+      } else if (byte == kEscape) {
+        state_ = State::kOscEscape;
+      }
+      return;
+
+    case State::kOscEscape:
+      ++stats_.sequences;
+
+      if (byte == '\\') {
+        state_ = State::kGround;
+      } else {
+        ConsumeEscape(byte);
+      }
+      return;
+  }
+}
+
+void curs::internal::VirtualTerminal::ConsumeText(unsigned char byte) {
+  if (utf8_remaining_ > 0) {
+    if ((byte & 0xc0) == 0x80) {
+      code_point_ = (code_point_ << 6) | (byte & 0x3f);
+
+      if (--utf8_remaining_ == 0) {
+        Print(code_point_);
+      }
+      return;
+    }
+
+    // The sequence was cut short.
+    utf8_remaining_ = 0;
+    Print(kReplacementCharacter);
+  }
+
+  if (byte < 0x80) {
+    Print(byte);
+  } else if ((byte & 0xe0) == 0xc0) {
+    code_point_ = byte & 0x1f;
+    utf8_remaining_ = 1;
+  } else if ((byte & 0xf0) == 0xe0) {
+    code_point_ = byte & 0x0f;
+    utf8_remaining_ = 2;
+  } else if ((byte & 0xf8) == 0xf0) {
+    code_point_ = byte & 0x07;
+    utf8_remaining_ = 3;
+  } else {
+    Print(kReplacementCharacter);
+  }
+}
+
+void curs::internal::VirtualTerminal::ConsumeEscape(unsigned char byte) {
+  if (byte == '[') {
+    state_ = State::kCsi;
+    parameters_[0] = 0;
+    parameter_count_ = 1;
+    private_marker_ = 0;
+    return;
+  }
+
+  if (byte == ']') {
+    state_ = State::kOsc;
+    return;
+  }
+
+  // Control characters are executed in the middle of a sequence.
+  if (byte < 0x20) {
+    if (byte != kEscape) {
+      ExecuteControl(byte);
+    }
+
+    state_ = State::kEscape;
+    return;
+  }
+
+  if (byte <= 0x2f) {
+    state_ = State::kEscapeIntermediate;
+    return;
+  }
+
+  state_ = State::kGround;
+  ExecuteEscape(byte);
+}
+
+void curs::internal::VirtualTerminal::ConsumeCsi(unsigned char byte) {
+  if (byte >= '0' && byte <= '9') {
+    int& parameter = parameters_[parameter_count_ - 1];
+
+    if (parameter < 10000) {
+      parameter = parameter * 10 + (byte - '0');
+    }
+    return;
+  }
+
+  // Subparameters (':') are read as parameters.
+  if (byte == ';' || byte == ':') {
+    if (parameter_count_ < kMaxParameters) {
+      parameters_[parameter_count_++] = 0;
+    }
+    return;
+  }
+
+  if (byte >= '<' && byte <= '?') {
+    private_marker_ = static_cast<char>(byte);
+    return;
+  }
+
+  // Intermediate bytes are not used by any supported sequence.
+  if (byte >= 0x20 && byte <= 0x2f) {
+    return;
+  }
+
+  if (byte == kEscape) {
+    state_ = State::kEscape;
+    return;
+  }
+
+  if (byte < 0x20) {
+    ExecuteControl(byte);
+    return;
+  }
+
+  state_ = State::kGround;
+  ExecuteCsi(byte);
+}
+
+void curs::internal::VirtualTerminal::ExecuteControl(unsigned char byte) {
+  switch (byte) {
+    case '\r':
+      cursor_x_ = 0;
+      is_pending_wrap_ = false;
+      break;
+
+    case '\n':
+    case '\v':
+    case '\f':
+      LineFeed();
+      break;
+
+    case '\b':
+      if (cursor_x_ > 0) {
+        --cursor_x_;
+      }
+      is_pending_wrap_ = false;
+      break;
+
+    case '\t':
+      cursor_x_ = std::min<short>((cursor_x_ / kTabWidth + 1) * kTabWidth, size_.cols - 1);
+      is_pending_wrap_ = false;
+      break;
+
+    default:
+      break;
+  }
+}
+
+void curs::internal::VirtualTerminal::ExecuteEscape(unsigned char final_byte) {
+  ++stats_.sequences;
+
+  switch (final_byte) {
+    case '7': // DECSC: save the cursor.
+      saved_y_ = cursor_y_;
+      saved_x_ = cursor_x_;
+      break;
+
+    case '8': // DECRC: restore the cursor.
+      MoveCursor(saved_y_, saved_x_);
+      break;
+
+    case 'D': // IND: index.
+      LineFeed();
+      break;
+
+    case 'E': // NEL: next line.
+      cursor_x_ = 0;
+      LineFeed();
+      break;
+
+    case 'M': // RI: reverse index.
+      if (cursor_y_ == scroll_top_) {
+        ScrollRows(scroll_top_, scroll_bottom_, -1);
+      } else if (cursor_y_ > 0) {
+        --cursor_y_;
+      }
+      is_pending_wrap_ = false;
+      break;
+
+    case 'c': // RIS: full reset.
+      Reset();
+      break;
+
+    case '\\': // ST without a string to terminate.
+      break;
+
+    default:
+      ++stats_.unknown;
+      break;
+  }
+}
+
+void curs::internal::VirtualTerminal::ExecuteCsi(unsigned char final_byte) {
+  ++stats_.sequences;
+
+  // The only private sequences understood are the modes set and reset
+  // with "ESC [ ? <mode> h" and "ESC [ ? <mode> l".
+  if (private_marker_ != 0) {
+    if (private_marker_ != '?' || (final_byte != 'h' && final_byte != 'l')) {
+      ++stats_.unknown;
+      return;
+    }
+
+    bool enable = final_byte == 'h';
+
+    for (int i = 0; i < parameter_count_; ++i) {
+      switch (parameters_[i]) {
+        case 25: // DECTCEM: cursor visibility.
+          is_cursor_visible_ = enable;
+          break;
+
+        case 47:
+        case 1047:
+        case 1049: // Alternate screen: starts blank, the main screen is not kept.
+          std::fill(cells_.begin(), cells_.end(), VirtualCell());
+          break;
+
+        default:
+          break;
+      }
+    }
+    return;
+  }
+
+  const int count = Parameter(0, 1);
+
+  switch (final_byte) {
+    case '@': { // ICH: insert blank characters.
+      VirtualCell* row = &Cell(cursor_y_, 0);
+      int shift = std::min<int>(count, size_.cols - cursor_x_);
+
+      std::copy_backward(row + cursor_x_, row + size_.cols - shift, row + size_.cols);
+      Erase(cursor_y_, cursor_x_, static_cast<short>(cursor_x_ + shift));
+      is_pending_wrap_ = false;
+      break;
+    }
+
+    case 'A': // CUU: cursor up, stopping at the top margin.
+      MoveCursor(std::max<int>(cursor_y_ - count, cursor_y_ >= scroll_top_ ? scroll_top_ : 0),
+                 cursor_x_);
+      break;
+
+    case 'B': // CUD: cursor down, stopping at the bottom margin.
+    case 'e': // VPR
+      MoveCursor(std::min<int>(cursor_y_ + count,
+                               cursor_y_ <= scroll_bottom_ ? scroll_bottom_ : size_.rows - 1),
+                 cursor_x_);
+      break;
+
+    case 'C': // CUF: cursor forward.
+    case 'a': // HPR
+      MoveCursor(cursor_y_, cursor_x_ + count);
+      break;
+
+    case 'D': // CUB: cursor back.
+      MoveCursor(cursor_y_, cursor_x_ - count);
+      break;
+
+    case 'E': // CNL: next line.
+      MoveCursor(cursor_y_ + count, 0);
+      break;
+
+    case 'F': // CPL: previous line.
+      MoveCursor(cursor_y_ - count, 0);
+      break;
+
+    case 'G': // CHA: cursor to column.
+    case '`': // HPA
+      MoveCursor(cursor_y_, count - 1);
+      break;
+
+    case 'H': // CUP: cursor position.
+    case 'f': // HVP
+      MoveCursor(count - 1, Parameter(1, 1) - 1);
+      break;
+
+    case 'J': // ED: erase in display.
+      switch (parameters_[0]) {
+        case 0:
+          Erase(cursor_y_, cursor_x_, size_.cols);
+          for (short y = cursor_y_ + 1; y < size_.rows; ++y) {
+            Erase(y, 0, size_.cols);
+          }
+          break;
+
+        case 1:
+          for (short y = 0; y < cursor_y_; ++y) {
+            Erase(y, 0, size_.cols);
+          }
+          Erase(cursor_y_, 0, cursor_x_ + 1);
+          break;
+
+        default:
+          for (short y = 0; y < size_.rows; ++y) {
+            Erase(y, 0, size_.cols);
+          }
+          break;
+      }
+      break;
+
+    case 'K': // EL: erase in line.
+      switch (parameters_[0]) {
+        case 0:
+          Erase(cursor_y_, cursor_x_, size_.cols);
+          break;
+
+        case 1:
+          Erase(cursor_y_, 0, cursor_x_ + 1);
+          break;
+
+        default:
+          Erase(cursor_y_, 0, size_.cols);
+          break;
+      }
+      break;
+
+    case 'L': // IL: insert lines, inside the scroll region only.
+      if (cursor_y_ >= scroll_top_ && cursor_y_ <= scroll_bottom_) {
+        ScrollRows(cursor_y_, scroll_bottom_, -count);
+        cursor_x_ = 0;
+        is_pending_wrap_ = false;
+      }
+      break;
+
+    case 'M': // DL: delete lines, inside the scroll region only.
+      if (cursor_y_ >= scroll_top_ && cursor_y_ <= scroll_bottom_) {
+        ScrollRows(cursor_y_, scroll_bottom_, count);
+        cursor_x_ = 0;
+        is_pending_wrap_ = false;
+      }
+      break;
+
+    case 'P': { // DCH: delete characters.
+      VirtualCell* row = &Cell(cursor_y_, 0);
+      int shift = std::min<int>(count, size_.cols - cursor_x_);
+
+      std::copy(row + cursor_x_ + shift, row + size_.cols, row + cursor_x_);
+      Erase(cursor_y_, static_cast<short>(size_.cols - shift), size_.cols);
+      is_pending_wrap_ = false;
+      break;
+    }
+
+    case 'S': // SU: scroll up.
+      ScrollRows(scroll_top_, scroll_bottom_, count);
+      break;
+
+    case 'T': // SD: scroll down.
+      ScrollRows(scroll_top_, scroll_bottom_, -count);
+      break;
+
+    case 'X': // ECH: erase characters, the cursor stays.
+      Erase(cursor_y_, cursor_x_, static_cast<short>(std::min<int>(cursor_x_ + count, size_.cols)));
+      is_pending_wrap_ = false;
+      break;
+
+    case 'b': { // REP: repeat the last printed character.
+      int repeat = std::min<int>(count, static_cast<int>(cells_.size()));
+
+      for (int i = 0; i < repeat; ++i) {
+        Print(last_symbol_);
+      }
+      break;
+    }
+
+    case 'd': // VPA: cursor to row.
+      MoveCursor(count - 1, cursor_x_);
+      break;
+
+    case 'm':
+      ExecuteSgr();
+      break;
+
+    case 'r': { // DECSTBM: set the scroll region, the cursor goes home.
+      int top = Parameter(0, 1) - 1;
+      int bottom = std::min<int>(Parameter(1, size_.rows), size_.rows) - 1;
+
+      if (top < bottom) {
+        scroll_top_ = static_cast<short>(top);
+        scroll_bottom_ = static_cast<short>(bottom);
+      }
+
+      MoveCursor(0, 0);
+      break;
+    }
+
+    case 's': // SCOSC: save the cursor.
+      saved_y_ = cursor_y_;
+      saved_x_ = cursor_x_;
+      break;
+
+    case 'u': // SCORC: restore the cursor.
+      MoveCursor(saved_y_, saved_x_);
+      break;
+
+    default:
+      ++stats_.unknown;
+      break;
+  }
+}
+
+void curs::internal::VirtualTerminal::ExecuteSgr() {
+  for (int i = 0; i < parameter_count_; ++i) {
+    int parameter = parameters_[i];
+
+    if (parameter == 38 || parameter == 48) {
+      // Extended colors: "38;5;<index>" or "38;2;<r>;<g>;<b>".
+      int color = kDefaultColor;
+
+      if (i + 2 < parameter_count_ && parameters_[i + 1] == 5) {
+        color = parameters_[i + 2] & 0xff;
+        i += 2;
+      } else if (i + 4 < parameter_count_ && parameters_[i + 1] == 2) {
+        color = kRgbColor | (parameters_[i + 2] & 0xff) << 16 |
+                (parameters_[i + 3] & 0xff) << 8 | (parameters_[i + 4] & 0xff);
+        i += 4;
+      } else {
+        ++stats_.unknown;
+        return;
+      }
+
+      (parameter == 38 ? pen_.foreground : pen_.background) = color;
+      continue;
+    }
+
+    if (parameter >= 30 && parameter <= 37) {
+      pen_.foreground = parameter - 30;
+    } else if (parameter >= 40 && parameter <= 47) {
+      pen_.background = parameter - 40;
+    } else if (parameter >= 90 && parameter <= 97) {
+      pen_.foreground = parameter - 90 + 8;
+    } else if (parameter >= 100 && parameter <= 107) {
+      pen_.background = parameter - 100 + 8;
+    } else {
+      switch (parameter) {
+        case 0:
+          pen_ = VirtualCell();
+          break;
+        case 1:
+          pen_.attributes |= kBold;
+          break;
+        case 2:
+          pen_.attributes |= kDim;
+          break;
+        case 3:
+          pen_.attributes |= kItalic;
+          break;
+        case 4:
+          pen_.attributes |= kUnderline;
+          break;
+        case 5:
+          pen_.attributes |= kBlink;
+          break;
+        case 7:
+          pen_.attributes |= kReverse;
+          break;
+        case 22:
+          pen_.attributes &= ~(kBold | kDim);
+          break;
+        case 23:
+          pen_.attributes &= ~kItalic;
+          break;
+        case 24:
+          pen_.attributes &= ~kUnderline;
+          break;
+        case 25:
+          pen_.attributes &= ~kBlink;
+          break;
+        case 27:
+          pen_.attributes &= ~kReverse;
+          break;
+        case 39:
+          pen_.foreground = kDefaultColor;
+          break;
+        case 49:
+          pen_.background = kDefaultColor;
+          break;
+        default:
+          ++stats_.unknown;
+          break;
+      }
+    }
+  }
+}
+
+void curs::internal::VirtualTerminal::Print(char32_t symbol) {
+  const int width = GetCharWidth(symbol);
+
+  // Combining characters, the characters after a zero width joiner and the
+  // second half of a flag belong to the character before them, whose cell
+  // keeps only its first code point.
+  if (width == 0 || previous_code_point_ == kZeroWidthJoiner ||
+      (is_flag_open_ && IsRegionalIndicator(symbol))) {
+    previous_code_point_ = symbol;
+    is_flag_open_ = false;
+    return;
+  }
+
+  previous_code_point_ = symbol;
+  is_flag_open_ = IsRegionalIndicator(symbol);
+
+  // The character after one in the last column starts the next row, and so
+  // does a wide character that does not fit into the last column.
+  if (is_pending_wrap_ || (width == 2 && cursor_x_ == size_.cols - 1)) {
+    cursor_x_ = 0;
+    LineFeed();
+  }
+
+  // A wide character that loses one half is blanked.
+  if (cursor_x_ > 0 && Cell(cursor_y_, cursor_x_).symbol == kWideContinuation) {
+    Cell(cursor_y_, cursor_x_ - 1).symbol = U' ';
+  }
+
+  if (cursor_x_ + width < size_.cols &&
+      Cell(cursor_y_, cursor_x_ + width).symbol == kWideContinuation) {
+    Cell(cursor_y_, cursor_x_ + width).symbol = U' ';
+  }
+
+  VirtualCell& cell = Cell(cursor_y_, cursor_x_);
+  cell = pen_;
+  cell.symbol = symbol;
+
+  if (width == 2 && cursor_x_ + 1 < size_.cols) {
+    VirtualCell& continuation = Cell(cursor_y_, cursor_x_ + 1);
+    continuation = pen_;
+    continuation.symbol = kWideContinuation;
+  }
+
+  last_symbol_ = symbol;
+  ++stats_.printed;
+
+  if (cursor_x_ + width >= size_.cols) {
+    cursor_x_ = size_.cols - 1;
+    is_pending_wrap_ = true;
+  } else {
+    cursor_x_ += width;
+  }
+}
+
+void curs::internal::VirtualTerminal::LineFeed() {
+  if (cursor_y_ == scroll_bottom_) {
+    ScrollRows(scroll_top_, scroll_bottom_, 1);
+  } else if (cursor_y_ < size_.rows - 1) {
+    ++cursor_y_;
+  }
+
+  is_pending_wrap_ = false;
+}
+
+void curs::internal::VirtualTerminal::MoveCursor(int y, int x) {
+  cursor_y_ = static_cast<short>(std::max(0, std::min<int>(y, size_.rows - 1)));
+  cursor_x_ = static_cast<short>(std::max(0, std::min<int>(x, size_.cols - 1)));
+  is_pending_wrap_ = false;
+}
+
+void curs::internal::VirtualTerminal::ScrollRows(short top, short bottom, int count) {
+  const int height = bottom - top + 1;
+  const int shift = std::min(count > 0 ? count : -count, height);
+  const std::size_t cols = size_.cols;
+
+  auto row = [&](int y) { return cells_.begin() + y * cols; };
+
+  if (count > 0) {
+    std::copy(row(top + shift), row(bottom + 1), row(top));
+
+    for (int y = bottom - shift + 1; y <= bottom; ++y) {
+      Erase(static_cast<short>(y), 0, size_.cols);
+    }
+  } else {
+    std::copy_backward(row(top), row(bottom + 1 - shift), row(bottom + 1));
+
+    for (int y = top; y < top + shift; ++y) {
+      Erase(static_cast<short>(y), 0, size_.cols);
+    }
+  }
+}
+
+void curs::internal::VirtualTerminal::Erase(short y, short begin, short end) {
+  if (begin >= end) {
+    return;
+  }
+
+  std::fill(cells_.begin() + y * size_.cols + begin, cells_.begin() + y * size_.cols + end,
+            Blank());
+}
+
+curs::internal::VirtualCell curs::internal::VirtualTerminal::Blank() const {
+  // Erased cells look like spaces printed without attributes.
+  VirtualCell blank;
+  blank.foreground = pen_.foreground;
+  blank.background = pen_.background;
+  return blank;
+}
@@ -18,21 +18,134 @@
 #ifdef _WIN32 
   #include "iostream"
   #include <sstream>
-
-  #include "wcurses/buffer.h"
-  #include "wcurses/color_manager.h"
-  #include "wcurses/input_manager.h"
-  #include "wcurses/terminal.h"
 #else
   #include <ncurses.h>
 #endif
 
+#include "wcurses/buffer.h"
+#include "wcurses/color_manager.h"
+#include "wcurses/input_manager.h"
+#include "wcurses/layer.h"
+#include "wcurses/pad.h"
+#include "wcurses/render_thread.h"
+#include "wcurses/terminal.h"
+#include "wcurses/window.h"
+
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <thread> 
+#include <vector>
 
 #include <wcurses/key.h>
+#include <wcurses/number_format.h>
 #include <wcurses/point.h>
 
+#ifndef _WIN32
+namespace {
+
+// Outputs a number through ncurses without format parsing or temporary strings.
+template <typename T>
+void AddInteger(T val) {
+  char digits[curs::internal::kMaxIntegerLength];
+  char* digits_end = digits + curs::internal::kMaxIntegerLength;
+  char* first = curs::internal::FormatInteger(val, digits_end);
+
+  addnstr(first, static_cast<int>(digits_end - first));
+}
+
+// Outputs a floating-point value through ncurses without format parsing.
+template <typename T>
+void AddFloat(T val, int precision, curs::FloatFormat format) {
+  char digits[curs::internal::kFloatBufferSize];
+  size_t length = curs::internal::FormatFloat(val, precision, format, digits, sizeof(digits));
+
+  if(length < sizeof(digits)) {
+    addnstr(digits, static_cast<int>(length));
+    return;
+  }
+
+  // Only huge values in fixed notation do not fit on the stack.
+  std::string long_digits(length + 1, '\0');
+  curs::internal::FormatFloat(val, precision, format, &long_digits[0], long_digits.size());
+  addnstr(long_digits.data(), static_cast<int>(length));
+}
+
+// Converts text attributes into the attributes of ncurses.
+attr_t ToNcursesAttributes(curs::Attr attributes) {
+  const struct {
+    curs::Attr attribute;
+    attr_t ncurses_attribute;
+  } kAttributes[] = {
+    {curs::Attr::kBold, A_BOLD},
+    {curs::Attr::kDim, A_DIM},
+#ifdef A_ITALIC
+    {curs::Attr::kItalic, A_ITALIC},
+#endif
+    {curs::Attr::kUnderline, A_UNDERLINE},
+    {curs::Attr::kBlink, A_BLINK},
+    {curs::Attr::kReverse, A_REVERSE}
+  };
+
+  attr_t ncurses_attributes = A_NORMAL;
+
+  for(const auto& attribute : kAttributes) {
+    if((attributes & attribute.attribute) != curs::Attr::kNormal) {
+      ncurses_attributes |= attribute.ncurses_attribute;
+    }
+  }
+
+  return ncurses_attributes;
+}
+
+
+// Converts a character for the line and fill functions of ncurses, which
+// take single bytes: ASCII is kept, and the box drawing lines and corners
+// become the line characters of the alternate character set.
+chtype ToNcursesSymbol(char32_t symbol) {
+  switch(symbol) {
+    case 0x2500: return ACS_HLINE;
+    case 0x2502: return ACS_VLINE;
+    case 0x250c: return ACS_ULCORNER;
+    case 0x2510: return ACS_URCORNER;
+    case 0x2514: return ACS_LLCORNER;
+    case 0x2518: return ACS_LRCORNER;
+    case 0x253c: return ACS_PLUS;
+    default: return symbol < 0x80 ? static_cast<chtype>(symbol) : '?';
+  }
+}
+
+// Returns the attributes and the color pair text is currently written with.
+chtype GetNcursesRendition() {
+  attr_t attributes;
+  short pair;
+  attr_get(&attributes, &pair, nullptr);
+
+  return (attributes & ~A_COLOR) | COLOR_PAIR(pair);
+}
+
+// Calls draw(y, x, count) for every row span of rect that lies on the
+// screen, and restores the cursor afterwards.
+template <typename F>
+void ForEachNcursesSpan(const curs::Rect& rect, F draw) {
+  int cursor_y;
+  int cursor_x;
+  getyx(stdscr, cursor_y, cursor_x);
+
+  const int left = std::max<int>(rect.x, 0);
+  const int right = std::min<int>(rect.x + rect.cols, COLS);
+  const int bottom = std::min<int>(rect.y + rect.rows, LINES);
+
+  for(int y = std::max<int>(rect.y, 0); y < bottom && left < right; ++y) {
+    draw(y, left, right - left);
+  }
+
+  move(cursor_y, cursor_x);
+}
+
+} // namespace
+#endif
+
 curs::Wcurses::~Wcurses() {
   Endwin();
 }
@@ -55,6 +168,16 @@ void curs::Wcurses::Initscr(Size size) {
   buffer_ = new internal::Buffer(size);
   input_manager_ = new internal::InputManager; 
 
+  // Changes can only be positioned on the screen with escape sequences.
+  buffer_->SetEscapeSequences(terminal_->IsVirtualModeEnabled());
+  buffer_->SetCapabilities(capabilities_);
+
+  if(!is_color_depth_selected_) {
+    color_depth_ = terminal_->GetColorDepth();
+  }
+
+  buffer_->SetColorDepth(color_depth_);
+
   // Configure terminal settings.
   terminal_->ClearScreen();
   terminal_->SetTerminalSize(size.rows, size.cols);
@@ -74,27 +197,106 @@ void curs::Wcurses::Initscr(Size size) {
 }
 #else
 // Wcurses initialization method for Linux/macOS.
-void curs::Wcurses::Initscr() {
-  initscr();
-  keypad(stdscr, TRUE);
-  noecho();
+void curs::Wcurses::Initscr(Size size, Backend backend) {
+  if(was_initialized_) {
+    return;
+  }
+
+  backend_ = backend;
+
+  if(backend_ == Backend::kNcurses) {
+    initscr();
+    keypad(stdscr, TRUE);
+    noecho();
+    return;
+  }
+
+  // Allocate necessary resources. The buffer covers the whole terminal.
+  if(backend_ == Backend::kHeadless) {
+    terminal_ = new internal::Terminal(size);
+  } else {
+    terminal_ = new internal::Terminal;
+  }
+
+  Point terminal_size = terminal_->GetSize();
+  buffer_ = new internal::Buffer(terminal_size.y, terminal_size.x);
+  input_manager_ = new internal::InputManager;
+
+  buffer_->SetEscapeSequences(terminal_->IsVirtualModeEnabled());
+  buffer_->SetCapabilities(capabilities_);
+
+  if(!is_color_depth_selected_) {
+    color_depth_ = terminal_->GetColorDepth();
+  }
+
+  buffer_->SetColorDepth(color_depth_);
+
+  terminal_->ClearScreen();
+
+  was_initialized_ = true;
+
+  Refresh();
+}
+
+const curs::internal::VirtualTerminal* curs::Wcurses::GetVirtualTerminal() const {
+  if(!was_initialized_) {
+    return nullptr;
+  }
+
+  return terminal_->GetVirtualTerminal();
+}
+
+bool curs::Wcurses::UpdateSize() {
+  if(!terminal_->WasResized()) {
+    return false;
+  }
+
+  Point size = terminal_->GetSize();
+  buffer_->Resize(size.y, size.x);
+
+  // Terminals rearrange or drop their contents on resize, so
+  // the next frame repaints the whole screen.
+  buffer_->Invalidate();
+
+  if(render_thread_) {
+    render_thread_->Invalidate();
+  }
+
+  return true;
 }
 #endif
 
 void curs::Wcurses::Endwin() {
-#ifdef _WIN32
+  // The last frame is not lost to the frame rate or to a congested terminal.
+  DrainOutput();
+
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    endwin(); // Shutdown ncurses.
+    return;
+  }
+#endif
+
   if(!was_initialized_) {
     return;
   }
 
+  // Write the last frame and take the terminal back.
+  SetAsyncRendering(false);
+
   // Restore terminal settings.
   *terminal_ << buffer_->GetCodeResetColor();
+#ifdef _WIN32
   terminal_->RestoreTerminalMode();
   terminal_->SetMaximizeButton(true);
   terminal_->SetWindowResizing(true);
   terminal_->SetCursorVisible(true);
 
   terminal_->ClearScreen();
+#else
+  terminal_->SetCursorVisible(true);
+  terminal_->RestoreTerminalMode();
+#endif
 
   // Free allocated resources.
   delete terminal_;
@@ -106,453 +308,829 @@ void curs::Wcurses::Endwin() {
   delete input_manager_;
   input_manager_ = nullptr;
 
+#ifdef _WIN32
   std::cout.rdbuf(original_cout_buffer_);
   std::cin.rdbuf(original_cin_buffer_);
+#endif
 
   was_initialized_ = false;
-#else
-  endwin(); // Shutdown ncurses.
-#endif
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(char ch) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    addch(ch);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << ch;
-#else
-  addch(ch);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(const char* str) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    addstr(str);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << str;
-#else
-  printw(str);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(const std::string& str) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    addnstr(str.data(), static_cast<int>(str.size()));
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << str;
-#else
-  printw(str.c_str());
+
+  return *this;
+}
+
+curs::Wcurses& curs::Wcurses::Write(const char* str, std::size_t length) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    addnstr(str, static_cast<int>(length));
+    return *this;
+  }
 #endif
 
+  if(!was_initialized_) {
+    return *this;
+  }
+
+  buffer_->Write(str, length);
+
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(short val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddInteger(val);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%d", val);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(int val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddInteger(val);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%d", val);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(long val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddInteger(val);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%ld", val);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(long long val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddInteger(val);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%lld", val);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(unsigned short val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddInteger(val);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%u", val);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(unsigned val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddInteger(val);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%u", val);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(unsigned long val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddInteger(val);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%lu", val);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(unsigned long long val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddInteger(val);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%llu", val);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(float val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddFloat(val, float_precision_, float_format_);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%f", val);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(double val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddFloat(val, float_precision_, float_format_);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%f", val);
-#endif
 
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator<<(long double val) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    AddFloat(val, float_precision_, float_format_);
+    return *this;
+  }
+#endif
+
   if(!was_initialized_) {
     return *this;
   }
 
   *buffer_ << val;
-#else
-  printw("%f", val);
-#endif
 
   return *this;
 }
 
-curs::Wcurses& curs::Wcurses::operator<<(Wcurses& (*pf)(Wcurses&)) {
-#ifdef _WIN32
-  if(!was_initialized_) {
-    return *this;
+void curs::Wcurses::SetPrecision(int precision) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    float_precision_ = precision < 0 ? 0 : precision;
+    return;
   }
 #endif
 
-  return pf(*this);
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->SetPrecision(precision);
 }
 
-curs::Wcurses& curs::Wcurses::operator>>(int& val) {
-#ifdef _WIN32
+void curs::Wcurses::SetFloatFormat(FloatFormat format) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    float_format_ = format;
+    return;
+  }
+#endif
+
   if(!was_initialized_) {
-    return *this;
+    return;
   }
 
-  *input_manager_ >> val;
-#else
-  val = getch();
-#endif
+  buffer_->SetFloatFormat(format);
+}
 
+curs::Wcurses& curs::Wcurses::operator<<(Wcurses& (*pf)(Wcurses&)) {
+  return pf(*this);
+}
+
+curs::Wcurses& curs::Wcurses::operator>>(int& val) {
+  val = GetCh();
   return *this;
 }
 
 curs::Wcurses& curs::Wcurses::operator>>(Key& val) {
-#ifdef _WIN32
-  if(!was_initialized_) {
-    return *this;
-  }
-
-  *input_manager_ >> val;
-#else
-  val = static_cast<Key>(getch());
-#endif
-
+  val = GetKey();
   return *this;
 }
 
 int curs::Wcurses::GetCh() {
-#ifdef _WIN32
-  if(!was_initialized_) {
-    return input_manager_->Err();
+  // The screen has to be up to date while the user is waiting for a key.
+  if(no_delay_) {
+    FlushIfDue();
+  } else {
+    DrainOutput();
   }
 
-  return input_manager_->GetCh();
-#else
-  return getch();
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    return getch();
+  }
 #endif
-}
 
-curs::Key curs::Wcurses::GetKey() {
-#ifdef _WIN32
   if(!was_initialized_) {
-    return Key::kError;
+    return internal::InputManager::Err();
   }
 
-  return input_manager_->GetKey();
+#ifdef _WIN32
+  return input_manager_->GetCh();
 #else
-  return static_cast<Key>(getch());
+  // A headless terminal has no keyboard.
+  if(backend_ == Backend::kHeadless) {
+    return internal::InputManager::Err();
+  }
+
+  // A resize is reported as a key, like ncurses does.
+  if(UpdateSize()) {
+    return static_cast<int>(Key::kResize);
+  }
+
+  int key_code = input_manager_->GetCh();
+
+  // The resize signal also interrupts the wait for a key.
+  if(key_code == internal::InputManager::Err() && UpdateSize()) {
+    return static_cast<int>(Key::kResize);
+  }
+
+  return key_code;
 #endif
 }
 
+curs::Key curs::Wcurses::GetKey() {
+  return static_cast<Key>(GetCh());
+}
+
 void curs::Wcurses::Nodelay(bool enable) {
-#ifdef _WIN32
+  no_delay_ = enable;
+
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    nodelay(stdscr, enable);
+    return;
+  }
+#endif
+
   if(!was_initialized_) {
     return;
   }
 
   input_manager_->NoDelay(enable);
-#else 
-  nodelay(stdscr, enable);
-#endif
 }
 
 void curs::Wcurses::FlushInput() {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    flushinp();
+    return;
+  }
+#endif
+
   if(!was_initialized_) {
     return;
   }
 
   input_manager_->Clear();
-#else 
-  flushinp();
-#endif
 }
 
 void curs::Wcurses::Refresh() {
-#ifdef _WIN32
+  // Coalesce the refreshes of a frame interval into a single frame. While
+  // the terminal is congested, refreshes are dropped into the pending frame.
+  if(is_frame_pending_) {
+    if(is_frame_dropped_) {
+      ++frame_stats_.dropped;
+    } else {
+      ++frame_stats_.coalesced;
+    }
+  }
+
+  is_frame_pending_ = true;
+
+  if(frame_interval_ == Clock::duration::zero()) {
+    Flush();
+  } else {
+    FlushIfDue();
+  }
+}
+
+void curs::Wcurses::SetFrameRate(unsigned frames_per_second) {
+  frame_interval_ = frames_per_second == 0
+      ? Clock::duration::zero()
+      : std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / frames_per_second;
+
+  // Without a frame rate nothing may stay pending.
+  if(is_frame_pending_ && frame_interval_ == Clock::duration::zero()) {
+    Flush();
+  }
+}
+
+const std::vector<curs::FrameSegment>& curs::Wcurses::GetFrameSegments() const {
+  static const std::vector<FrameSegment> kNoSegments;
+
+  if(!was_initialized_ || render_thread_) {
+    return kNoSegments;
+  }
+
+  return buffer_->GetFrameSegments();
+}
+
+void curs::Wcurses::SetCapabilities(const Capabilities& capabilities) {
+  capabilities_ = capabilities;
+
+  if(buffer_) {
+    buffer_->SetCapabilities(capabilities_);
+  }
+
+  if(render_thread_) {
+    render_thread_->SetCapabilities(capabilities_);
+  }
+}
+
+void curs::Wcurses::SetColorDepth(ColorDepth color_depth) {
+  color_depth_ = color_depth;
+  is_color_depth_selected_ = true;
+
+  // The render thread takes the new color codes with the next frame.
+  if(buffer_) {
+    buffer_->SetColorDepth(color_depth_);
+  }
+}
+
+bool curs::Wcurses::SetAsyncRendering(bool enable) {
+  if(!was_initialized_ || !terminal_->IsVirtualModeEnabled()) {
+    return false;
+  }
+
+  if(enable && !render_thread_) {
+    render_thread_ = new internal::RenderThread(*terminal_, frame_stats_);
+    render_thread_->SetCapabilities(capabilities_);
+  } else if(!enable && render_thread_) {
+    // Write the frame still pending and keep the counters.
+    render_thread_->Wait();
+    UpdateFrameStats();
+
+    delete render_thread_;
+    render_thread_ = nullptr;
+
+    // Frames are encoded here again, against an unknown terminal state.
+    buffer_->Invalidate();
+  }
+
+  return true;
+}
+
+void curs::Wcurses::UpdateFrameStats() {
+  // The render thread counts the output, the refreshes are counted here.
+  FrameStats stats = render_thread_->GetFrameStats();
+  stats.coalesced = frame_stats_.coalesced;
+  frame_stats_ = stats;
+}
+
+void curs::Wcurses::FlushIfDue() {
+  if(is_frame_pending_ && Clock::now() - last_frame_time_ >= frame_interval_) {
+    Flush();
+  } else if(was_initialized_ && !render_thread_) {
+    SendPendingOutput();
+  }
+}
+
+bool curs::Wcurses::SendPendingOutput() {
+  unsigned long long syscalls = terminal_->GetSyscallCount();
+  unsigned long long stalls = terminal_->GetStallCount();
+
+  bool is_sent = terminal_->SendPendingOutput();
+
+  frame_stats_.syscalls += terminal_->GetSyscallCount() - syscalls;
+  frame_stats_.stalls += terminal_->GetStallCount() - stalls;
+  return is_sent;
+}
+
+void curs::Wcurses::DrainOutput() {
+  // The render thread drains the output by itself.
+  if(!was_initialized_ || render_thread_) {
+    if(is_frame_pending_) {
+      Flush();
+    }
+
+    return;
+  }
+
+  // A frame skipped so far is drawn as soon as the output drained.
+  do {
+    if(is_frame_pending_) {
+      Flush();
+    }
+
+    unsigned long long syscalls = terminal_->GetSyscallCount();
+    unsigned long long stalls = terminal_->GetStallCount();
+
+    terminal_->DrainOutput();
+
+    frame_stats_.syscalls += terminal_->GetSyscallCount() - syscalls;
+    frame_stats_.stalls += terminal_->GetStallCount() - stalls;
+  } while(is_frame_pending_);
+}
+
+void curs::Wcurses::Flush() {
+  // A frame the terminal cannot take yet is skipped. Its changes stay in the
+  // buffer and go out with the next frame, so only the newest state is sent.
+  if(was_initialized_ && !render_thread_ && !SendPendingOutput()) {
+    if(!is_frame_dropped_) {
+      ++frame_stats_.dropped;
+      is_frame_dropped_ = true;
+    }
+
+    is_frame_pending_ = true;
+    return;
+  }
+
+  is_frame_pending_ = false;
+  is_frame_dropped_ = false;
+  last_frame_time_ = Clock::now();
+
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    refresh();
+    return;
+  }
+#endif
+
   if(!was_initialized_) {
     return;
   }
 
+#ifndef _WIN32
+  // Draw the frame for the current size of the terminal
+  UpdateSize();
+#endif
+
   // Get the current state of cursor visibility
   bool cursor_visibility = terminal_->GetCursorVisible();
 
-  // If the cursor is visible, hide it to avoid flickering
-  if(cursor_visibility) {
-    SetCursorVisibility(false);
-  }
+  // Leave the encoding and the writing to the render thread
+  if(render_thread_) {
+    if(render_thread_->Publish(buffer_->ComposeFrame(), buffer_->GetColorManager(),
+                               buffer_->GetCursorPosition(), cursor_visibility)) {
+      ++frame_stats_.coalesced;
+    }
 
-  // Move the cursor to the upper left corner of the screen
-  terminal_->ResetCursor();
-
-  // Update the screen buffer
-  buffer_->RefreshScreenBuffer();
+    buffer_->ClearDamage();
+    UpdateFrameStats();
+    return;
+  }
 
-  // Print the contents of the buffer to the terminal
-  *terminal_ << buffer_->GetScreenBuffer();
+  // Collect the changes made since the previous refresh
+  buffer_->RefreshScreenBuffer(cursor_visibility);
+
+  const std::vector<FrameSegment>& segments = buffer_->GetFrameSegments();
+  const std::size_t frame_size = buffer_->GetFrameSize();
+  unsigned long long syscalls = terminal_->GetSyscallCount();
+  unsigned long long stalls = terminal_->GetStallCount();
+
+  if(terminal_->IsVirtualModeEnabled()) {
+    // The frame draws the changes and places the cursor by itself, so it
+    // reaches the terminal in a single write. What the terminal does not
+    // take right away stays pending and is sent before the next frame
+    if(frame_size > 0) {
+      terminal_->WriteFrame(segments.data(), segments.size());
+    }
+  } else {
+    if(frame_size > 0) {
+      // If the cursor is visible, hide it to avoid flickering
+      if(cursor_visibility) {
+        SetCursorVisibility(false);
+      }
+
+      // Without escape sequences the buffer holds the whole screen,
+      // which starts in the upper left corner
+      terminal_->ResetCursor();
+
+      // Print the changes to the terminal
+      terminal_->WriteFrame(segments.data(), segments.size());
+    }
+
+    // Get the current cursor position from the buffer
+    Point cursor = buffer_->GetCursorPosition(); 
+
+    // Move the cursor to the desired position after the screen refreshes
+    terminal_->MoveCursor(cursor.y, cursor.x);
+
+    if(frame_size > 0 && cursor_visibility) {
+      SetCursorVisibility(true);
+    }
+  }
 
-  // Get the current cursor position from the buffer
-  Point cursor = buffer_->GetCursorPosition(); 
+  // Account for the output of the frame
+  syscalls = terminal_->GetSyscallCount() - syscalls;
 
-  // Move the cursor to the desired position after the screen refreshes
-  terminal_->MoveCursor(cursor.y, cursor.x);
+  frame_stats_.last_frame_bytes = static_cast<unsigned long>(frame_size);
+  frame_stats_.last_frame_syscalls = static_cast<unsigned long>(syscalls);
+  frame_stats_.bytes += frame_size;
+  frame_stats_.syscalls += syscalls;
+  frame_stats_.stalls += terminal_->GetStallCount() - stalls;
 
-  if (cursor_visibility) {
-    SetCursorVisibility(true);
+  if(syscalls > 0) {
+    ++frame_stats_.frames;
   }
-#else   
-  refresh();
-#endif
 }
 
 bool curs::Wcurses::HasColor() {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    return has_colors();
+  }
+#endif
+
   if(!was_initialized_) {
     return false;
   }
-  return terminal_->IsVirtualModeEnabled();
-#else 
-  return has_colors();
-#endif
+
+  return terminal_->IsVirtualModeEnabled() && color_depth_ != ColorDepth::kMonochrome;
 }
 
 void curs::Wcurses::StartColor() {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    start_color();
+    return;
+  }
+#endif
+
   if(!was_initialized_ || !HasColor()) {
     return;
   }
 
   buffer_->StartColor();
-#else  
-  start_color();
-#endif
 }
 
 void curs::Wcurses::InitColor(
     short color_index,
     const RGB& rgb) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    init_color(color_index, rgb.red * 1000 / 255, rgb.green * 1000 / 255, rgb.blue * 1000 / 255);
+    return;
+  }
+#endif
+
   if(!was_initialized_ || !HasColor()) {
     return;
   }
 
   buffer_->InitColor(color_index, rgb);
-#else  
-  init_color(color_index, rgb.red * 1000 / 255, rgb.green * 1000 / 255, rgb.blue * 1000 / 255);
-#endif
 }
 
 void curs::Wcurses::InitColor(
     short color_index,
     short r, short g, short b) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    init_color(color_index, r * 1000 / 255, g * 1000 / 255, b * 1000 / 255);
+    return;
+  }
+#endif
+
   if(!was_initialized_ || !HasColor()) {
     return;
   }
 
   buffer_->InitColor(color_index, r, g, b);
-#else  
-  init_color(color_index, r * 1000 / 255, g * 1000 / 255, b * 1000 / 255);
-#endif
 }
 
 void curs::Wcurses::InitPair(
     short pair_index,
     const ColorPair& color_pair) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    init_pair(pair_index, color_pair.foreground, color_pair.background);
+    return;
+  }
+#endif
+
   if(!was_initialized_ || !HasColor()) {
     return;
   }
 
   buffer_->InitPair(pair_index, color_pair);
-#else 
-  init_pair(pair_index, color_pair.foreground, color_pair.background);
-#endif
 }
 
 void curs::Wcurses::InitPair(
     short pair_index,
     short foreground, short background) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    init_pair(pair_index, foreground, background);
+    return;
+  }
+#endif
+
   if(!was_initialized_ || !HasColor()) {
     return;
   }
 
   buffer_->InitPair(pair_index, foreground, background);
-#else 
-  init_pair(pair_index, foreground, background);
-#endif
 }
 
 void curs::Wcurses::BkGd(short pair_index) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    bkgd(COLOR_PAIR(pair_index));
+    return;
+  }
+#endif
+
   if(!was_initialized_ || !HasColor()) {
     return;
   }
 
   buffer_->InitDefaultPair(pair_index);
-#else   
-  bkgd(COLOR_PAIR(pair_index));
-#endif 
 }
 
-
-
 void curs::Wcurses::Attron(short pair_index) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    attron(COLOR_PAIR(pair_index));
+    return;
+  }
+#endif
+
   if(!was_initialized_ || !HasColor()) {
     return;
   }
 
   buffer_->SetActivePair(pair_index);
-#else 
-  attron(COLOR_PAIR(pair_index));
-#endif  
 }
 
 void curs::Wcurses::Attroff() {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    attroff(A_COLOR);
+    return;
+  }
+#endif
+
   if(!was_initialized_ || !HasColor()) {
     return;
   }
 
   buffer_->ResetToDefaultPair();
-#else 
-  attroff(A_COLOR);
+}
+
+void curs::Wcurses::Attron(Attr attributes) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    attron(ToNcursesAttributes(attributes));
+    return;
+  }
+#endif
+
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->AttributesOn(attributes);
+}
+
+void curs::Wcurses::Attroff(Attr attributes) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    attroff(ToNcursesAttributes(attributes));
+    return;
+  }
 #endif
+
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->AttributesOff(attributes);
 }
 
 void curs::Wcurses::Sleep(unsigned milliseconds) {
-  std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+  Clock::time_point wake_time = Clock::now() + std::chrono::milliseconds(milliseconds);
+
+  // A pending frame is drawn on time, and output the terminal did not take
+  // yet is sent once it can, even if that is during the pause.
+  for(;;) {
+    Clock::time_point now = Clock::now();
+
+    if(now >= wake_time) {
+      return;
+    }
+
+    if(was_initialized_ && !render_thread_ && terminal_->HasPendingOutput()) {
+      auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(wake_time - now);
+
+      if(terminal_->WaitWritable(static_cast<int>(timeout.count()) + 1)) {
+        FlushIfDue();
+      }
+    } else if(is_frame_pending_ && last_frame_time_ + frame_interval_ < wake_time) {
+      std::this_thread::sleep_until(last_frame_time_ + frame_interval_);
+      Flush();
+    } else {
+      std::this_thread::sleep_until(wake_time);
+    }
+  }
 }
 
 #ifdef _WIN32
@@ -574,66 +1152,278 @@ void curs::Wcurses::SetFontSettings(SHORT fontSize, const std::wstring& fontName
 #endif
 
 void curs::Wcurses::MoveTo(short y, short x) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    move(y, x);
+    return;
+  }
+#endif
+
   if(!was_initialized_) {
-      return;
+    return;
   }
 
   buffer_->Move(y, x);
-#else 
-  move(y, x);
-#endif
 }
 
 void curs::Wcurses::MoveBy(short y, short x) {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    Point cursorPosition = Getyx();
+    move(cursorPosition.y + y, cursorPosition.x + x);
+    return;
+  }
+#endif
+
   if(!was_initialized_) {
     return;
   }
 
   buffer_->MoveBy(y, x);
-#else 
-  Point cursorPosition = Getyx();
-  move(cursorPosition.y + y, cursorPosition.x + x);
-#endif
 }
 
 curs::Point curs::Wcurses::Getyx() const {
-#ifdef _WIN32
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    Point cursorPosition{0, 0};
+
+    getyx(stdscr, cursorPosition.y, cursorPosition.x);
+
+    return cursorPosition;
+  }
+#endif
+
   if(!was_initialized_) {
     return {0, 0};
   }
 
   return buffer_->GetCursorPosition();
-#else 
-  Point cursorPosition{0, 0};
+}
 
-	getyx(stdscr, cursorPosition.y, cursorPosition.x);
+void curs::Wcurses::ScrollOk(bool enable) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    scrollok(stdscr, enable);
+    return;
+  }
+#endif
 
-	return cursorPosition; 
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->SetScrolling(enable);
+}
+
+void curs::Wcurses::SetScrollRegion(short top, short bottom) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    setscrreg(top, bottom);
+    return;
+  }
 #endif
+
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->SetScrollRegion(top, bottom);
 }
 
-void curs::Wcurses::ClearScreen() {   
-#ifdef _WIN32
+void curs::Wcurses::Scroll(short lines) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    scrl(lines);
+    return;
+  }
+#endif
+
   if(!was_initialized_) {
     return;
   }
 
-  return buffer_->Clear();
-  Refresh();
-#else   
-  clear();
-  Refresh();
+  buffer_->Scroll(lines);
+}
+
+void curs::Wcurses::FillRect(const Rect& rect, char32_t symbol) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    const chtype ch = ToNcursesSymbol(symbol) | GetNcursesRendition();
+    ForEachNcursesSpan(rect, [ch](int y, int x, int count) { mvhline(y, x, ch, count); });
+    return;
+  }
 #endif
+
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->FillRect(rect, symbol);
+}
+
+void curs::Wcurses::ClearRect(const Rect& rect) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    ForEachNcursesSpan(rect, [](int y, int x, int count) { mvhline(y, x, ' ', count); });
+    return;
+  }
+#endif
+
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->ClearRect(rect);
+}
+
+void curs::Wcurses::ChangeAttrRect(const Rect& rect, Attr attributes, short pair_index) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    const attr_t ncurses_attributes = ToNcursesAttributes(attributes);
+    ForEachNcursesSpan(rect, [=](int y, int x, int count) {
+      mvchgat(y, x, count, ncurses_attributes, pair_index, nullptr);
+    });
+    return;
+  }
+#endif
+
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->ChangeAttrRect(rect, attributes, pair_index);
+}
+
+void curs::Wcurses::DrawPad(const Pad& pad, const PointL& origin, const Rect& rect) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    ForEachNcursesSpan(rect, [&](int y, int x, int count) {
+      const long pad_y = origin.y + (y - rect.y);
+      const long pad_x = origin.x + (x - rect.x);
+
+      for(int i = 0; i < count; ++i) {
+        const internal::ChType cell = pad.GetCell(pad_y, pad_x + i);
+        const chtype symbol = cell.symbol == internal::kWideContinuation ? ' ' : ToNcursesSymbol(cell.symbol);
+
+        mvaddch(y, x + i, symbol | ToNcursesAttributes(cell.attributes) | COLOR_PAIR(cell.color_pair));
+      }
+    });
+    return;
+  }
+#endif
+
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->DrawPad(pad, origin, rect);
+}
+
+void curs::Wcurses::HLine(short y, short x, short length, char32_t symbol) {
+  FillRect({y, x, 1, length}, symbol);
+}
+
+void curs::Wcurses::VLine(short y, short x, short length, char32_t symbol) {
+  FillRect({y, x, length, 1}, symbol);
+}
+
+curs::Window curs::Wcurses::NewWindow(const Rect& rect) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    return Window();
+  }
+#endif
+
+  if(!was_initialized_) {
+    return Window();
+  }
+
+  return Window(buffer_, rect);
+}
+
+curs::Layer* curs::Wcurses::NewLayer(const Rect& rect) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    return nullptr;
+  }
+#endif
+
+  if(!was_initialized_) {
+    return nullptr;
+  }
+
+  return buffer_->NewLayer(rect);
+}
+
+void curs::Wcurses::DeleteLayer(Layer* layer) {
+  if(buffer_ && layer != nullptr) {
+    buffer_->DeleteLayer(layer);
+  }
+}
+
+curs::Snapshot curs::Wcurses::TakeSnapshot() {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    return Snapshot();
+  }
+#endif
+
+  if(!was_initialized_) {
+    return Snapshot();
+  }
+
+  return Snapshot(buffer_->TakeSnapshot());
+}
+
+void curs::Wcurses::RestoreSnapshot(const Snapshot& snapshot) {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    return;
+  }
+#endif
+
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->RestoreSnapshot(snapshot.snapshot_);
+}
+
+void curs::Wcurses::ClearScreen() {
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    clear();
+    Refresh();
+    return;
+  }
+#endif
+
+  if(!was_initialized_) {
+    return;
+  }
+
+  buffer_->Clear();
+  Refresh();
 }
 
 void curs::Wcurses::SetCursorVisibility(int visibility) {
-#ifdef _WIN32
-terminal_->SetCursorVisible(visibility);
-#else 
-  curs_set(visibility);
+#ifndef _WIN32
+  if(backend_ == Backend::kNcurses) {
+    curs_set(visibility);
+    return;
+  }
 #endif
+
+  if(!was_initialized_) {
+    return;
+  }
+
+  // The render thread must not be writing at the same time.
+  if(render_thread_) {
+    render_thread_->Wait();
+  }
+
+  terminal_->SetCursorVisible(visibility);
 }
 
 curs::Wcurses& curs::Endl(Wcurses& wcurses) {
@@ -0,0 +1,205 @@
+// This file is part of wcuses.
+//
+// wcuses is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// wcuses is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with wcuses.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "wcurses/window.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "wcurses/buffer.h"
+#include "wcurses/cell_grid.h"
+#include "wcurses/color_manager.h"
+#include "wcurses/number_format.h"
+#include "wcurses/pad.h"
+#include "wcurses/point.h"
+#include "wcurses/structures.h"
+
+curs::Window::Window(internal::Buffer* buffer, const Rect& rect, internal::CellGrid* grid)
+    : buffer_(buffer) {
+  view_.grid = grid;
+  SetRect(rect);
+}
+
+curs::Window& curs::Window::operator<<(char ch) {
+  if (buffer_ != nullptr) {
+    buffer_->Put(view_, ch);
+  }
+
+  return *this;
+}
+
+curs::Window& curs::Window::operator<<(const char* str) {
+  return Write(str, std::strlen(str));
+}
+
+curs::Window& curs::Window::operator<<(const std::string& str) {
+  return Write(str.data(), str.size());
+}
+
+template <typename T>
+curs::Window& curs::Window::WriteInteger(T val) {
+  char digits[internal::kMaxIntegerLength];
+  char* digits_end = digits + internal::kMaxIntegerLength;
+  char* first = internal::FormatInteger(val, digits_end);
+
+  return Write(first, digits_end - first);
+}
+
+curs::Window& curs::Window::operator<<(int val) {
+  return WriteInteger(val);
+}
+
+curs::Window& curs::Window::operator<<(long val) {
+  return WriteInteger(val);
+}
+
+curs::Window& curs::Window::operator<<(long long val) {
+  return WriteInteger(val);
+}
+
+curs::Window& curs::Window::operator<<(unsigned val) {
+  return WriteInteger(val);
+}
+
+curs::Window& curs::Window::operator<<(unsigned long val) {
+  return WriteInteger(val);
+}
+
+curs::Window& curs::Window::operator<<(unsigned long long val) {
+  return WriteInteger(val);
+}
+
+curs::Window& curs::Window::operator<<(double val) {
+  if (buffer_ == nullptr) {
+    return *this;
+  }
+
+  char digits[internal::kFloatBufferSize];
+  std::size_t length = internal::FormatFloat(val, buffer_->GetPrecision(),
+                                             buffer_->GetFloatFormat(), digits, sizeof(digits));
+
+  if (length < sizeof(digits)) {
+    return Write(digits, length);
+  }
+
+  // Only huge values in fixed notation do not fit on the stack.
+  std::string long_digits(length + 1, '\0');
+  internal::FormatFloat(val, buffer_->GetPrecision(), buffer_->GetFloatFormat(),
+                        &long_digits[0], long_digits.size());
+
+  return Write(long_digits.data(), length);
+}
+
+curs::Window& curs::Window::Write(const char* str, std::size_t length) {
+  if (buffer_ != nullptr) {
+    buffer_->Write(view_, str, length);
+  }
+
+  return *this;
+}
+
+void curs::Window::MoveTo(short y, short x) {
+  view_.cursor.Move(y, x);
+}
+
+curs::Point curs::Window::Getyx() const {
+  return view_.cursor.GetPosition();
+}
+
+void curs::Window::Attron(short pair_index) {
+  if (buffer_ != nullptr && buffer_->GetColorManager().IsPairUsable(pair_index)) {
+    view_.pair = pair_index;
+  }
+}
+
+void curs::Window::Attroff() {
+  view_.pair = internal::ColorManager::GetDefaultPair();
+}
+
+void curs::Window::Attron(Attr attributes) {
+  view_.attributes = view_.attributes | attributes;
+}
+
+void curs::Window::Attroff(Attr attributes) {
+  view_.attributes = view_.attributes & ~attributes;
+}
+
+void curs::Window::Clear() {
+  ClearRect({0, 0, view_.rect.rows, view_.rect.cols});
+  view_.cursor.Reset();
+}
+
+void curs::Window::FillRect(const Rect& rect, char32_t symbol) {
+  if (buffer_ != nullptr) {
+    buffer_->FillRect(view_, rect, symbol);
+  }
+}
+
+void curs::Window::ClearRect(const Rect& rect) {
+  if (buffer_ != nullptr) {
+    buffer_->ClearRect(view_, rect);
+  }
+}
+
+void curs::Window::ChangeAttrRect(const Rect& rect, Attr attributes, short pair_index) {
+  if (buffer_ != nullptr) {
+    buffer_->ChangeAttrRect(view_, rect, attributes, pair_index);
+  }
+}
+
+void curs::Window::DrawPad(const Pad& pad, const PointL& origin, const Rect& rect) {
+  if (buffer_ != nullptr) {
+    buffer_->DrawPad(view_, pad, origin, rect);
+  }
+}
+
+void curs::Window::HLine(short y, short x, short length, char32_t symbol) {
+  FillRect({y, x, 1, length}, symbol);
+}
+
+void curs::Window::VLine(short y, short x, short length, char32_t symbol) {
+  FillRect({y, x, length, 1}, symbol);
+}
+
+void curs::Window::MoveWindow(short y, short x) {
+  SetRect({y, x, view_.rect.rows, view_.rect.cols});
+}
+
+void curs::Window::Resize(short rows, short cols) {
+  SetRect({view_.rect.y, view_.rect.x, rows, cols});
+}
+
+void curs::Window::SetRect(Rect rect) {
+  if (buffer_ == nullptr) {
+    return;
+  }
+
+  const Size& size = view_.grid != nullptr ? view_.grid->GetSize() : buffer_->GetSize();
+
+  rect.y = std::max<short>(0, std::min<short>(rect.y, size.rows - 1));
+  rect.x = std::max<short>(0, std::min<short>(rect.x, size.cols - 1));
+  rect.rows = std::max<short>(1, std::min<short>(rect.rows, size.rows - rect.y));
+  rect.cols = std::max<short>(1, std::min<short>(rect.cols, size.cols - rect.x));
+
+  view_.rect = rect;
+
+  // The cursor keeps its position, as far as the new size allows.
+  Point cursor = view_.cursor.GetPosition();
+  view_.cursor.SetLimit(rect.rows, rect.cols);
+  view_.cursor.Move(std::min<short>(cursor.y, rect.rows - 1),
+                    std::min<short>(cursor.x, rect.cols - 1));
+}